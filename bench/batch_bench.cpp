@@ -0,0 +1,61 @@
+#include "../include/lexer/lexer.hpp"
+#include "../include/syntaxer/syntaxer.hpp"
+#include <chrono>
+
+
+using namespace std;
+
+
+template<class F>
+double best_of(const int& runs, const F& f) {
+    double best = 1e100;
+    for (int i = 0; i < runs; i++) {
+        auto start = chrono::steady_clock::now();
+        f();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+
+void measure(const string& expression, const vector<double>& xs) {
+    auto source = "double f(double x) { return " + expression + "; }";
+    auto tokens = Lexer::parse(source);
+    auto ast = Syntaxer::parse(tokens);
+    const auto& def = static_cast<const FuncDef&>(*ast->declarations[0]);
+    const Expr& expr = *static_cast<const Return&>(*def.block->statements[0]).ret_expr;
+
+    vector<double> scalar(xs.size()), batched(xs.size());
+    double scalar_time = best_of(3, [&] {
+        for (size_t i = 0; i < xs.size(); i++)
+            scalar[i] = expr.eval(xs[i]);
+    });
+    double batch_time = best_of(3, [&] { expr.eval_batch(xs, batched); });
+
+    double worst = 0;
+    for (size_t i = 0; i < xs.size(); i++)
+        if (scalar[i] != batched[i])
+            worst = max(worst, fabs(scalar[i] - batched[i]) / max(1.0, fabs(scalar[i])));
+
+    double points = xs.size();
+    cout << expression << endl
+         << "  eval:       " << scalar_time * 1e9 / points << " ns/point" << endl
+         << "  eval_batch: " << batch_time * 1e9 / points << " ns/point, "
+         << points * 2 * sizeof(double) / batch_time / 1e9 << " GB/s in+out (" << scalar_time / batch_time << "x)"
+         << ", max relative error " << worst << endl;
+}
+
+
+// batch_bench [points=4000000]
+int main(int argc, char** argv) {
+    size_t points = argc > 1 ? stoul(argv[1]) : 4000000;
+    vector<double> xs(points);
+    for (size_t i = 0; i < points; i++)
+        xs[i] = 1e-3 + 20.0 * i / points;
+
+    measure("x * x * 0.5 - 3 * x + 2", xs);
+    measure("sin(x) * exp(-x * x / 8) + log(x + 10)", xs);
+    measure("pow(x, 2.5) + cos(x) / (1 + x * x)", xs);
+    return 0;
+}
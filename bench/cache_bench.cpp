@@ -0,0 +1,89 @@
+#include "../include/prepared.hpp"
+#include "generator.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+
+using namespace std;
+
+
+template<class F>
+double best_of(const int& runs, const F& f) {
+    double best = 1e100;
+    for (int i = 0; i < runs; i++) {
+        auto start = chrono::steady_clock::now();
+        f();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+
+string disassembly(const PreparedProgram& program) {
+    ostringstream text;
+    program.print_bytecode(text);
+    return text.str();
+}
+
+
+// cache_bench [functions=2000] [runs=5]
+int main(int argc, char** argv) {
+    size_t functions = argc > 1 ? stoul(argv[1]) : 2000;
+    int runs = argc > 2 ? stoi(argv[2]) : 5;
+
+    auto dir = filesystem::temp_directory_path() / ("proglang_cache_bench_" + to_string(functions));
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+    auto file_name = (dir / "program.txt").string();
+    auto source = generate_program(functions) + "int main() {\n    printf(\"%d functions\\n\", " +
+                  to_string(functions) + ");\n    return 7;\n}\n";
+    ofstream(file_name, ios::binary) << source;
+    ProgramCache cache((dir / "cache").string());
+
+    auto compiled = PreparedProgram::load(file_name);
+    if (!cache.store(source, compiled.program())) {
+        cerr << "cache_bench: cannot write to " << cache.directory() << endl;
+        return 1;
+    }
+    auto cached = PreparedProgram::load(file_name, cache);
+    int compiled_result, cached_result;
+    auto compiled_output = compiled.run("", compiled_result), cached_output = cached.run("", cached_result);
+    if (disassembly(cached) != disassembly(compiled) || cached_output != compiled_output || cached_result != compiled_result) {
+        cerr << "cache_bench: the cached program differs from the compiled one" << endl;
+        return 1;
+    }
+
+    // a stale cache entry (the source changed) must not be used
+    ofstream(file_name, ios::binary) << source << "\n";
+    if (cache.load(source + "\n") || !cache.load(source)) {
+        cerr << "cache_bench: the cache does not tell sources apart" << endl;
+        return 1;
+    }
+    ofstream(file_name, ios::binary) << source;
+
+    // a well-formed file whose code reads past a frame must not be used either
+    auto damaged = compiled.program();
+    damaged.functions[damaged.entry].code.front().a = 255;
+    if (!cache.store(source, damaged) || cache.load(source) || !cache.store(source, compiled.program())) {
+        cerr << "cache_bench: the cache accepts out-of-range operands" << endl;
+        return 1;
+    }
+
+    double cold = best_of(runs, [&] { PreparedProgram::load(file_name); });
+    double warm = best_of(runs, [&] { PreparedProgram::load(file_name, cache); });
+    double miss = best_of(runs, [&] {
+        filesystem::remove(cache.path(source));
+        PreparedProgram::load(file_name, cache);
+    });
+
+    cout << "source: " << source.size() / 1024 << " KB, " << functions << " functions; cache file: "
+         << filesystem::file_size(cache.path(source)) / 1024 << " KB" << endl;
+    cout << "compile:      " << cold * 1e3 << " ms" << endl;
+    cout << "cache miss:   " << miss * 1e3 << " ms (compile + store)" << endl;
+    cout << "cache hit:    " << warm * 1e3 << " ms (" << cold / warm << "x)" << endl;
+    filesystem::remove_all(dir);
+    return 0;
+}
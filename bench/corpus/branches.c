@@ -0,0 +1,22 @@
+int main() {
+    int i = 0, low = 0, middle = 0, six = 0, high = 0;
+    while (i < 3000) {
+        int j = 0;
+        while (j < 1000) {
+            int k = (i * 7 + j * 13) % 10;
+            if (k < 3) {
+                low = low + j;
+            } elif (k < 6) {
+                middle = (middle + i) % 1000003;
+            } elif (k == 6) {
+                six++;
+            } else {
+                high = (high * 3 + k) % 65521;
+            }
+            j++;
+        }
+        i++;
+    }
+    printf("low %d, middle %d, six %d, high %d\n", low, middle, six, high);
+    return (low + middle + six + high) % 256;
+}
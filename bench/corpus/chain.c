@@ -0,0 +1,49 @@
+// Long left-nested chains: each level computes into the destination register,
+// so 300 terms compile within a handful of registers.
+int twice(int x) {
+    return x + x;
+}
+
+int main() {
+    int a = 1;
+    int sum =
+        a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+        + a + a + a + a + a + a + a + a + a + a + a + a;
+    double c = 0.5;
+    double mixed =
+        c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c * c + c
+        * c + c * c + c * c + c * c + c * c + c * c + c * c + c;
+    int calls = twice(a) + twice(a) + twice(a) + twice(a) + twice(a) + twice(a);
+    printf("%d %g %d\n", sum, mixed, calls);
+    return sum - 300;
+}
@@ -0,0 +1,22 @@
+int calls = 0;
+
+int fib(int n) {
+    calls++;
+    if (n < 2) {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+int main() {
+    int n = 0;
+    while (n <= 24) {
+        if (n % 6 == 0) {
+            printf("fib(%d) = %d\n", n, fib(n));
+        }
+        n++;
+    }
+    int result = fib(30);
+    printf("fib(30) = %d after %d calls\n", result, calls);
+    return result % 256;
+}
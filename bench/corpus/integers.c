@@ -0,0 +1,16 @@
+// Integer constants are folded in int64 like the VM computes them, so a folded
+// product matches the same product of variables even above 2^53; in C the
+// 32-bit int wraps both alike. Every difference printed is 0 or 1.
+int main() {
+    int a = 123456789;
+    int b = 987654321;
+    int folded = 123456789 * 987654321;
+    int computed = a * b;
+    print(folded - computed, 123456789 * 987654321 - a * b);
+    print(9007199254740993 - 9007199254740992);
+    print(-7 / 2 - (0 - 7) / 2, -7 % 3 - (0 - 7) % 3);
+    if (folded == computed) {
+        printf("folded and computed products agree\n");
+    }
+    return folded - computed;
+}
@@ -0,0 +1,49 @@
+double pi = 3.141592653589793;
+
+double energy(double ms, double mp, double mq, double sx, double sy, double px, double py, double qx, double qy) {
+    double sp = pow((sx - px) * (sx - px) + (sy - py) * (sy - py), 0.5);
+    double sq = pow((sx - qx) * (sx - qx) + (sy - qy) * (sy - qy), 0.5);
+    double pq = pow((px - qx) * (px - qx) + (py - qy) * (py - qy), 0.5);
+    return -(ms * mp / sp + ms * mq / sq + mp * mq / pq);
+}
+
+// a sun, a planet and a moon-sized body, integrated with symplectic Euler steps
+int main() {
+    double ms = 1.0, mp = 0.001, mq = 0.0005;
+    double sx = 0.0, sy = 0.0, svx = 0.0, svy = 0.0;
+    double px = cos(0.0), py = sin(0.0), pvx = -sin(0.0), pvy = cos(0.0);
+    double qx = 1.6 * cos(pi / 3), qy = 1.6 * sin(pi / 3);
+    double qvx = -sin(pi / 3) / pow(1.6, 0.5), qvy = cos(pi / 3) / pow(1.6, 0.5);
+    double dt = 0.0005;
+    printf("energy before: %.12f\n", energy(ms, mp, mq, sx, sy, px, py, qx, qy));
+
+    int step = 0;
+    while (step < 200000) {
+        double dx = px - sx, dy = py - sy;
+        double fsp = dt / pow(dx * dx + dy * dy, 1.5);
+        double ex = qx - sx, ey = qy - sy;
+        double fsq = dt / pow(ex * ex + ey * ey, 1.5);
+        double gx = qx - px, gy = qy - py;
+        double fpq = dt / pow(gx * gx + gy * gy, 1.5);
+
+        svx = svx + (mp * fsp * dx + mq * fsq * ex);
+        svy = svy + (mp * fsp * dy + mq * fsq * ey);
+        pvx = pvx - ms * fsp * dx + mq * fpq * gx;
+        pvy = pvy - ms * fsp * dy + mq * fpq * gy;
+        qvx = qvx - ms * fsq * ex - mp * fpq * gx;
+        qvy = qvy - ms * fsq * ey - mp * fpq * gy;
+
+        sx = sx + dt * svx;
+        sy = sy + dt * svy;
+        px = px + dt * pvx;
+        py = py + dt * pvy;
+        qx = qx + dt * qvx;
+        qy = qy + dt * qvy;
+        step++;
+        if (step % 50000 == 0) {
+            printf("step %d: planet %.9f %.9f, moon %.9f %.9f\n", step, px, py, qx, qy);
+        }
+    }
+    printf("energy after:  %.12f\n", energy(ms, mp, mq, sx, sy, px, py, qx, qy));
+    return 0;
+}
@@ -0,0 +1,46 @@
+/* Included by the C compiler (cc -include prelude.h) when corpus programs are
+ * built as the reference: maps the interpreter's builtins onto C. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define elif else if
+
+/* int is 64 bits in the interpreter; integers.c overflows C's 32-bit int on
+ * purpose and prints only differences, which come out the same either way. */
+#pragma GCC diagnostic ignored "-Woverflow"
+
+static void print_string(const char* text) { fputs(text, stdout); }
+static void print_integer(long long value) { printf("%lld", value); }
+
+/* std::to_chars(double): the fewest significant digits that read back as the
+ * same value, in fixed or scientific notation, whichever is shorter (fixed on ties) */
+static void print_double(double value) {
+    char scientific[40], fixed[400];
+    int precision = 0;
+    for (; precision < 17; precision++) {
+        snprintf(scientific, sizeof(scientific), "%.*e", precision, value);
+        if (strtod(scientific, NULL) == value)
+            break;
+    }
+    const char* e = strchr(scientific, 'e');
+    int decimals = e ? precision - atoi(e + 1) : 0;
+    snprintf(fixed, sizeof(fixed), "%.*f", decimals > 0 ? decimals : 0, value);
+    fputs(strlen(fixed) <= strlen(scientific) ? fixed : scientific, stdout);
+}
+
+#define PRINT_ONE(x) _Generic((x), char*: print_string, const char*: print_string, \
+                              double: print_double, float: print_double, default: print_integer)(x)
+#define PRINT_1(a) (PRINT_ONE(a), putchar('\n'))
+#define PRINT_2(a, ...) (PRINT_ONE(a), putchar(' '), PRINT_1(__VA_ARGS__))
+#define PRINT_3(a, ...) (PRINT_ONE(a), putchar(' '), PRINT_2(__VA_ARGS__))
+#define PRINT_4(a, ...) (PRINT_ONE(a), putchar(' '), PRINT_3(__VA_ARGS__))
+#define PRINT_5(a, ...) (PRINT_ONE(a), putchar(' '), PRINT_4(__VA_ARGS__))
+#define PRINT_6(a, ...) (PRINT_ONE(a), putchar(' '), PRINT_5(__VA_ARGS__))
+#define PRINT_7(a, ...) (PRINT_ONE(a), putchar(' '), PRINT_6(__VA_ARGS__))
+#define PRINT_8(a, ...) (PRINT_ONE(a), putchar(' '), PRINT_7(__VA_ARGS__))
+#define PRINT_COUNT(_1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+#define PRINT_JOIN(a, b) a##b
+#define PRINT_N(n) PRINT_JOIN(PRINT_, n)
+#define print(...) PRINT_N(PRINT_COUNT(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0))(__VA_ARGS__)
@@ -0,0 +1,32 @@
+int is_prime(int n) {
+    if (n < 2) {
+        return 0;
+    }
+    if (n % 2 == 0) {
+        return n == 2;
+    }
+    int d = 3;
+    while (d * d <= n) {
+        if (n % d == 0) {
+            return 0;
+        }
+        d = d + 2;
+    }
+    return 1;
+}
+
+int main() {
+    int limit = 400000, count = 0, last = 0, twins = 0, n = 2;
+    while (n <= limit) {
+        if (is_prime(n)) {
+            if (n - last == 2) {
+                twins++;
+            }
+            count++;
+            last = n;
+        }
+        n++;
+    }
+    printf("%d primes up to %d, the largest %d, %d twin pairs\n", count, limit, last, twins);
+    return count % 256;
+}
@@ -0,0 +1,17 @@
+int main() {
+    int row = 0, total = 0;
+    while (row < 20000) {
+        int bucket = row * 7 % 13;
+        if (bucket < 4) {
+            print("row", row, "cold bucket", bucket);
+        } elif (bucket < 9) {
+            print("row", row, "warm bucket", bucket, "ratio", row / (bucket + 1.0));
+        } else {
+            printf("row %d: hot bucket %d, scaled %.3f\n", row, bucket, row * 0.125);
+        }
+        total = total + bucket;
+        row++;
+    }
+    print("total", total, "extremes", 0.0000001 * total, 10000000000000000000000.0 + total, -0.5, 1.0 / 3);
+    return total % 256;
+}
@@ -0,0 +1,8 @@
+// Adding a zero turns -0.0 into +0.0 and subtracting one keeps it, so the
+// folder may drop x + 0 only for integral x.
+int main() {
+    double z = -0.0;
+    int i = 5;
+    print(z + 0, 0 + z, z - 0, z * 1, z / 1, i + 0, 0 + i);
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include "../include/prepared.hpp"
+#include "../include/vm/vm.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifndef CORPUS_DIR
+#define CORPUS_DIR "bench/corpus"
+#endif
+
+
+using namespace std;
+
+
+// User-space CPU instructions retired by this thread, where the kernel allows counting them.
+class InstructionCounter {
+public:
+    InstructionCounter() {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~InstructionCounter() {
+#ifdef __linux__
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    bool available() const { return fd >= 0; }
+
+    template<class F>
+    uint64_t count(const F& f) {
+        uint64_t instructions = 0;
+#ifdef __linux__
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        f();
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &instructions, sizeof(instructions)) != sizeof(instructions))
+            instructions = 0;
+#endif
+        return instructions;
+    }
+
+private:
+    int fd = -1;
+};
+
+
+namespace { // peak_rss_kib() of stats.hpp reports the process peak instead
+
+
+// Linux lets a process reset its peak RSS, so every program gets its own;
+// elsewhere the figure is the peak of the whole run so far.
+void reset_peak_rss() {
+    ofstream("/proc/self/clear_refs") << "5";
+}
+
+
+long peak_rss_kib() {
+    ifstream status("/proc/self/status");
+    for (string line; getline(status, line);)
+        if (line.starts_with("VmHWM:"))
+            return stol(line.substr(6));
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+
+}
+
+
+// The program built by the system C compiler, with prelude.h mapping the builtins.
+struct Reference {
+    bool available = false;
+    string output;
+    int exit_code = 0;
+    double seconds = 0;
+};
+
+
+Reference run_reference(const filesystem::path& program, const string& cc, const filesystem::path& work) {
+    Reference reference;
+    auto binary = (work / program.stem()).string();
+    auto prelude = (program.parent_path() / "prelude.h").string();
+    auto build = cc + " -O2 -ffp-contract=off -include '" + prelude + "' '" + program.string() + "' -o '" + binary +
+                 "' -lm 2>&1";
+    if (system(build.c_str()) != 0)
+        return reference;
+
+    auto start = chrono::steady_clock::now();
+    FILE* pipe = popen(("'" + binary + "'").c_str(), "r");
+    if (!pipe)
+        return reference;
+    char buffer[1 << 14];
+    for (size_t n; (n = fread(buffer, 1, sizeof(buffer), pipe)) > 0;)
+        reference.output.append(buffer, n);
+    int status = pclose(pipe);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    reference.available = WIFEXITED(status);
+    reference.exit_code = WEXITSTATUS(status);
+    reference.seconds = elapsed.count();
+    return reference;
+}
+
+
+template<class F>
+double best_of(const int& runs, const F& f) {
+    double best = 1e100;
+    for (int i = 0; i < runs; i++) {
+        auto start = chrono::steady_clock::now();
+        f();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+
+// corpus_bench [runs=3] [program.c ...]; CC picks the reference compiler (default cc)
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? stoi(argv[1]) : 3;
+    vector<filesystem::path> programs;
+    for (int i = 2; i < argc; i++)
+        programs.emplace_back(argv[i]);
+    if (programs.empty()) {
+        for (const auto& entry : filesystem::directory_iterator(CORPUS_DIR))
+            if (entry.path().extension() == ".c")
+                programs.push_back(entry.path());
+        sort(programs.begin(), programs.end());
+    }
+    string cc = getenv("CC") ? getenv("CC") : "cc";
+    auto work = filesystem::temp_directory_path() / "proglang_corpus_bench";
+    filesystem::create_directories(work);
+
+    InstructionCounter counter;
+    bool failed = false;
+    for (const auto& path : programs) {
+        reset_peak_rss();
+        PreparedProgram prepared = PreparedProgram::compile("int main() { return 0; }");
+        double compile = best_of(runs, [&] { prepared = PreparedProgram::load(path.string()); });
+
+        string output;
+        int result = 0;
+        double run = best_of(runs, [&] {
+            ostringstream out;
+            istringstream in;
+            VM vm(prepared.program(), out, in);
+            result = vm.run();
+            output = move(out).str();
+        });
+        long rss = peak_rss_kib();
+
+        uint64_t executed = 0, instructions = 0;
+        {
+            ostringstream out;
+            istringstream in;
+            VM vm(prepared.program(), out, in);
+            vm.run(executed);
+        }
+        if (counter.available()) {
+            ostringstream out;
+            istringstream in;
+            VM vm(prepared.program(), out, in);
+            instructions = counter.count([&] { vm.run(); });
+        }
+
+        auto reference = run_reference(path, cc, work);
+        bool matches = reference.available && reference.output == output && reference.exit_code == (result & 0xff);
+        failed |= reference.available && !matches;
+
+        cout << path.stem().string() << ": compile " << compile * 1e3 << " ms, run " << run * 1e3 << " ms, peak RSS "
+             << rss / 1024.0 << " MB, " << executed / 1e6 << " M bytecode ops, " << run / executed * 1e9 << " ns/op";
+        if (instructions)
+            cout << ", " << double(instructions) / executed << " CPU instructions/op";
+        if (!reference.available)
+            cout << "; no reference (" << cc << " failed)" << endl;
+        else
+            cout << "; " << cc << " -O2 process " << reference.seconds * 1e3 << " ms (" << run / reference.seconds << "x), "
+                 << (matches ? "output matches" : "OUTPUT DIFFERS") << endl;
+    }
+    filesystem::remove_all(work);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,124 @@
+#include "../include/lexer/lexer.hpp"
+#include "../include/syntaxer/syntaxer.hpp"
+#include <chrono>
+#include <charconv>
+#include <functional>
+#include <unordered_map>
+
+
+using namespace std;
+
+
+// The evaluator Expr::eval replaced: string-keyed std::function tables, literals
+// parsed on every visit and a fresh argument vector per math call.
+namespace legacy {
+
+const unordered_map<string, function<double(const double&)>> unary_op_dict = {
+    {"+", [](const double& x) { return x; }},
+    {"-", [](const double& x) { return -x; }}
+};
+
+const unordered_map<string, function<double(const double&, const double&)>> binary_op_dict = {
+    {"+", [](const double& x, const double& y) { return x + y; }},
+    {"-", [](const double& x, const double& y) { return x - y; }},
+    {"*", [](const double& x, const double& y) { return x * y; }},
+    {"/", [](const double& x, const double& y) { return x / y; }},
+    {"**", [](const double& x, const double& y) { return pow(x, y); }}
+};
+
+const unordered_map<string, function<double(const vector<double>&)>> math_function_dict = {
+    {"pow", [](const vector<double>& args) { return pow(args[0], args[1]); }},
+    {"exp", [](const vector<double>& args) { return exp(args[0]); }},
+    {"log", [](const vector<double>& args) { return log(args[0]); }},
+    {"sin", [](const vector<double>& args) { return sin(args[0]); }},
+    {"cos", [](const vector<double>& args) { return cos(args[0]); }}
+};
+
+double eval(const Expr& expr, const double& x) {
+    switch (expr.type) {
+        case Expr::CONST: {
+            double number = 0;
+            from_chars(expr.value.data(), expr.value.data() + expr.value.size(), number);
+            return number;
+        }
+        case Expr::VAR:
+            return x;
+        case Expr::PRE_UNARY_OP:
+            return unary_op_dict.at(string(expr.value))(eval(*expr.branches[0], x));
+        case Expr::BINARY_OP:
+            return binary_op_dict.at(string(expr.value))(eval(*expr.branches[0], x), eval(*expr.branches[1], x));
+        case Expr::MATH_FUNC: {
+            vector<double> args;
+            for (const auto& it : expr.branches)
+                args.push_back(eval(*it, x));
+            return math_function_dict.at(string(expr.value))(args);
+        }
+        default:
+            throw runtime_error("legacy::eval(): Unsupported node");
+    }
+}
+
+}
+
+
+// A left-deep chain of `terms` operations over x and constants, with math calls mixed in.
+string deep_expression(const size_t& terms, const bool& math) {
+    const char* arithmetic[] = {" + x * 1.5", " - 0.25 / x", " * 0.999", " - -x", " + x / 3"};
+    const char* mixed[] = {" + x * 1.5", " - 0.25 / x", " * 0.999", " + sin(x)", " - -x", " + cos(x) * 2"};
+    string expression = "x";
+    for (size_t i = 0; i < terms; i++)
+        expression += math ? mixed[i % size(mixed)] : arithmetic[i % size(arithmetic)];
+    return expression;
+}
+
+
+size_t count_nodes(const Expr& expr) {
+    size_t count = 1;
+    for (auto& it : expr.branches)
+        count += count_nodes(*it);
+    return count;
+}
+
+
+template<class Eval>
+double best_of(const int& runs, const size_t& evaluations, double& checksum, const Eval& eval) {
+    double best = 1e100;
+    for (int i = 0; i < runs; i++) {
+        double sum = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t j = 0; j < evaluations; j++)
+            sum += eval(1.0 + j * 1e-3);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+        checksum = sum;
+    }
+    return best;
+}
+
+
+void measure(const string& name, const string& expression, const size_t& evaluations) {
+    auto source = "double f(double x) { return " + expression + "; }";
+    auto tokens = Lexer::parse(source);
+    auto ast = Syntaxer::parse(tokens);
+    const auto& def = static_cast<const FuncDef&>(*ast->declarations[0]);
+    const Expr& expr = *static_cast<const Return&>(*def.block->statements[0]).ret_expr;
+    auto nodes = count_nodes(expr);
+
+    double legacy_sum = 0, enum_sum = 0;
+    double legacy_time = best_of(3, evaluations, legacy_sum, [&](const double& x) { return legacy::eval(expr, x); });
+    double enum_time = best_of(3, evaluations, enum_sum, [&](const double& x) { return expr.eval(x); });
+    double scale = 1e9 / (double(evaluations) * nodes);
+    cout << name << " (" << nodes << " nodes): string maps " << legacy_time * scale << " ns/node, enum switch "
+         << enum_time * scale << " ns/node (" << legacy_time / enum_time << "x)"
+         << (legacy_sum == enum_sum ? "" : ", results differ") << endl;
+}
+
+
+// eval_bench [terms=300] [evaluations=20000]
+int main(int argc, char** argv) {
+    size_t terms = argc > 1 ? stoul(argv[1]) : 300;
+    size_t evaluations = argc > 2 ? stoul(argv[2]) : 20000;
+    measure("arithmetic", deep_expression(terms, false), evaluations);
+    measure("with math calls", deep_expression(terms, true), evaluations);
+    return 0;
+}
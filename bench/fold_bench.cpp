@@ -0,0 +1,119 @@
+#include "../include/lexer/lexer.hpp"
+#include "../include/syntaxer/syntaxer.hpp"
+#include "../include/syntaxer/folder.hpp"
+#include "../include/vm/compiler.hpp"
+#include "../include/vm/vm.hpp"
+#include <chrono>
+#include <sstream>
+
+
+using namespace std;
+
+
+// Constant subexpressions inside an expression evaluated in a loop.
+const string expression = "x * (2 ** 10 * 3) + sin(0.5) * 4 - x ** 2 * 1 + (10 - 4) / 3 + 0";
+
+
+string loop_program(const size_t& iterations) {
+    return "int main() {\n"
+           "    double x = 0;\n"
+           "    double sum = 0;\n"
+           "    while (x < " + to_string(iterations) + ") {\n"
+           "        sum = sum + " + expression + ";\n"
+           "        x = x + 1;\n"
+           "    }\n"
+           "    return sum % 251;\n"
+           "}\n";
+}
+
+
+// Output of a program compiled with and without folding.
+string run_output(const string& source, const bool& fold) {
+    auto tokens = Lexer::parse(source);
+    auto ast = Syntaxer::parse(tokens);
+    if (fold)
+        Folder::fold(*ast);
+    ostringstream out;
+    VM(Compiler::compile(*ast), out).run();
+    return out.str();
+}
+
+
+template<class Work>
+double best_of(const int& runs, const Work& work) {
+    double best = 1e100;
+    for (int i = 0; i < runs; i++) {
+        auto start = chrono::steady_clock::now();
+        work();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+
+size_t count_nodes(const Expr& expr) {
+    size_t count = 1;
+    for (auto& it : expr.branches)
+        count += count_nodes(*it);
+    return count;
+}
+
+
+// Expr::eval over the expression, evaluated for x = 0 .. evaluations - 1
+double eval_time(const AST& ast, const size_t& evaluations, double& checksum) {
+    auto& def = static_cast<const FuncDef&>(*ast.declarations[0]);
+    auto& ret = static_cast<const Return&>(*def.block->statements[0]);
+    checksum = 0;
+    return best_of(3, [&] {
+        double sum = 0;
+        for (size_t i = 0; i < evaluations; i++)
+            sum += ret.ret_expr->eval(i);
+        checksum = sum;
+    });
+}
+
+
+// fold_bench [evaluations=1000000] [loop iterations=10000000]
+int main(int argc, char** argv) {
+    size_t evaluations = argc > 1 ? stoul(argv[1]) : 1000000;
+    size_t iterations = argc > 2 ? stoul(argv[2]) : 10000000;
+
+    string function = "double f(double x) { return " + expression + "; }\n";
+    auto tokens = Lexer::parse(function);
+    auto ast = Syntaxer::parse(tokens);
+    auto& ret = static_cast<const Return&>(*static_cast<const FuncDef&>(*ast->declarations[0]).block->statements[0]);
+    auto nodes = count_nodes(*ret.ret_expr);
+    double plain_sum = 0, folded_sum = 0;
+    double plain = eval_time(*ast, evaluations, plain_sum);
+    auto removed = Folder::fold(*ast);
+    double folded = eval_time(*ast, evaluations, folded_sum);
+    cout << "eval: " << nodes << " -> " << count_nodes(*ret.ret_expr) << " nodes (" << removed << " removed), "
+         << plain * 1e9 / evaluations << " -> " << folded * 1e9 / evaluations << " ns/eval"
+         << (plain_sum == folded_sum ? "" : " (results differ)") << endl;
+
+    // -0.0 + 0 is +0.0, so x + 0 must stay for a double x
+    string signed_zero = "int main() {\n"
+                         "    double z = -0.0;\n"
+                         "    print(z + 0, 0 + z, z - 0, z * 1);\n"
+                         "    return 0;\n"
+                         "}\n";
+    auto zeros = run_output(signed_zero, true);
+    if (zeros != run_output(signed_zero, false) || zeros != "0 0 -0 -0\n") {
+        cerr << "fold_bench: folding changes the sign of a zero: " << zeros;
+        return 1;
+    }
+
+    auto source = loop_program(iterations);
+    auto loop_tokens = Lexer::parse(source);
+    auto loop_ast = Syntaxer::parse(loop_tokens);
+    auto plain_program = Compiler::compile(*loop_ast);
+    Folder::fold(*loop_ast);
+    auto folded_program = Compiler::compile(*loop_ast);
+    int plain_result = 0, folded_result = 0;
+    double plain_run = best_of(3, [&] { plain_result = VM(plain_program).run(); });
+    double folded_run = best_of(3, [&] { folded_result = VM(folded_program).run(); });
+    cout << "vm loop: " << plain_run * 1e9 / iterations << " -> " << folded_run * 1e9 / iterations << " ns/iteration"
+         << (plain_result == folded_result ? "" : " (results differ)") << endl;
+    return 0;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+using namespace std;
+
+
+// Deterministic program of `functions` functions, 176 tokens each.
+inline string generate_program(const size_t& functions) {
+    string source;
+    for (size_t i = 0; i < functions; i++) {
+        string name = {'f', char('a' + i % 26), char('a' + i / 26 % 26), char('a' + i / 676 % 26)};
+        source += "int " + name + "(int a, double b) {\n"
+                  "    int x = a + b * 2 - (a % 3), y = 0;\n"
+                  "    while (x < 100 && y != a) {\n"
+                  "        if (x == 3) {\n"
+                  "            x = x + 1;\n"
+                  "        } elif (x >= 5 || !y) {\n"
+                  "            y = sin(x) * cos(b) + pow(x, 2) ** 2;\n"
+                  "        } else {\n"
+                  "            print(\"value\", x, y);\n"
+                  "            break;\n"
+                  "        }\n"
+                  "        x = x + y / 4 - -a;\n"
+                  "    }\n"
+                  "    char c = 'q';\n"
+                  "    double z = exp(log(abs(x) + 1.5)) + sgn(y) * 0.25 + read();\n"
+                  "    while (z > 0) {\n"
+                  "        z = z - 1;\n"
+                  "        if (z == 10) {\n"
+                  "            continue;\n"
+                  "        }\n"
+                  "    }\n"
+                  "    return x + y * z;\n"
+                  "}\n\n";
+    }
+    return source;
+}
+
+
+// Shape of the programs generate_program(options) writes.
+struct GeneratorOptions {
+    size_t functions = 500;
+    size_t depth = 3; // nesting of if/while blocks inside a function body
+    size_t expression_size = 8; // operands per expression
+    size_t identifiers = 64; // distinct local names across the program; fewer means more reuse
+    uint64_t seed = 1;
+};
+
+
+// Deterministic, type-correct C-like program in the shape of `options`: every
+// function declares a few double locals named from a shared pool, nests
+// if/else and bounded while blocks, and returns an expression of x alone that
+// Expr::eval can evaluate. main returns 0 without calling them.
+inline string generate_program(const GeneratorOptions& options) {
+    uint64_t state = options.seed;
+    auto random = [&](const size_t& bound) {
+        // splitmix64
+        uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return size_t((z ^ (z >> 31)) % max<size_t>(bound, 1));
+    };
+    // identifiers are letters and underscores only
+    auto letters = [](size_t i) {
+        string text;
+        do {
+            text += char('a' + i % 26);
+            i /= 26;
+        } while (i);
+        return text;
+    };
+    auto identifier = [&](const size_t& i) { return "v_" + letters(i); };
+
+    string source;
+    vector<string> locals;
+    size_t counter = 0;
+
+    // `size` operands joined by operators, with math calls and negation mixed in
+    auto expression = [&](auto& self, const size_t& size, const bool& x_only) -> string {
+        if (size <= 1) {
+            auto pick = random(4);
+            if (pick == 0)
+                return to_string(random(100)) + "." + to_string(random(10));
+            return x_only || pick == 1 ? "x" : locals[random(locals.size())];
+        }
+        size_t left = 1 + random(size - 1);
+        const char* operators[] = {" + ", " - ", " * ", " / "};
+        auto text = self(self, left, x_only) + operators[random(4)] + self(self, size - left, x_only);
+        switch (random(6)) {
+            case 0: return "sin(" + text + ")";
+            case 1: return "cos(" + text + ")";
+            case 2: return "-(" + text + ")";
+            default: return "(" + text + ")";
+        }
+    };
+
+    auto block = [&](auto& self, const size_t& depth, const string& indent) -> void {
+        size_t statements = 2 + random(2);
+        for (size_t i = 0; i < statements; i++) {
+            auto target = locals[random(locals.size())];
+            if (depth == 0 || random(3) == 0) {
+                source += indent + target + " = " + expression(expression, options.expression_size, false) + ";\n";
+            } else if (random(2)) {
+                source += indent + "if (" + expression(expression, max<size_t>(options.expression_size / 2, 1), false) +
+                          " > " + target + ") {\n";
+                self(self, depth - 1, indent + "    ");
+                source += indent + "} else {\n";
+                self(self, depth - 1, indent + "    ");
+                source += indent + "}\n";
+            } else {
+                auto k = "k_" + letters(counter++);
+                source += indent + "int " + k + " = 0;\n" + indent + "while (" + k + " < 3) {\n";
+                self(self, depth - 1, indent + "    ");
+                source += indent + "    " + k + " = " + k + " + 1;\n" + indent + "}\n";
+            }
+        }
+    };
+
+    for (size_t f = 0; f < options.functions; f++) {
+        source += "double f_" + letters(f) + "(double x, int n) {\n";
+        locals.clear();
+        counter = 0;
+        size_t count = min<size_t>(2 + random(4), max<size_t>(options.identifiers, 1));
+        size_t first = random(options.identifiers);
+        for (size_t i = 0; i < count; i++) {
+            locals.push_back(identifier((first + i) % max<size_t>(options.identifiers, 1)));
+            source += "    double " + locals.back() + " = " + expression(expression, 2, true) + ";\n";
+        }
+        block(block, options.depth, "    ");
+        source += "    return " + expression(expression, options.expression_size, true) + ";\n}\n\n";
+    }
+    source += "int main() {\n    return 0;\n}\n";
+    return source;
+}
@@ -0,0 +1,108 @@
+#include "../include/lexer/lexer.hpp"
+#include "../include/syntaxer/syntaxer.hpp"
+#include "../include/vm/jit.hpp"
+#include <chrono>
+#include <cstring>
+
+
+using namespace std;
+
+
+struct Formula {
+    shared_ptr<string> source; // the AST refers to the source text
+    shared_ptr<AST> ast;
+    const Expr* expr;
+};
+
+
+Formula parse(const string& expression) {
+    auto source = make_shared<string>("double f(double x) { return " + expression + "; }");
+    auto tokens = Lexer::parse(*source);
+    Formula formula{source, Syntaxer::parse(tokens), nullptr};
+    const auto& def = static_cast<const FuncDef&>(*formula.ast->declarations[0]);
+    formula.expr = static_cast<const Return&>(*def.block->statements[0]).ret_expr.get();
+    return formula;
+}
+
+
+bool same(const double& a, const double& b) {
+    return memcmp(&a, &b, sizeof(a)) == 0 || (a != a && b != b);
+}
+
+
+// Every formula must give bit-identical results through the JIT and Expr::eval.
+size_t differential(const vector<string>& formulas) {
+    const double inputs[] = {0.0, -0.0, 1.0, -1.0, 0.5, 2.0, 3.0, -2.5, 1e-310, 1e300, -1e300,
+                             INFINITY, -INFINITY, NAN, 3.14159, 100.25, -7.75, 42.0};
+    size_t mismatches = 0;
+    for (const auto& text : formulas) {
+        auto formula = parse(text);
+        auto jit = JitFunction::compile(*formula.expr);
+        for (double x : inputs) {
+            double expected = formula.expr->eval(x), actual = jit(x);
+            if (!same(expected, actual) && mismatches++ < 20)
+                cerr << "jit_bench: " << text << " at x = " << x << ": eval " << expected << ", jit " << actual << endl;
+        }
+        for (int i = 0; i < 1000; i++) {
+            double x = -50 + i * 0.1003;
+            if (!same(formula.expr->eval(x), jit(x)) && mismatches++ < 20)
+                cerr << "jit_bench: " << text << " at x = " << x << " differs" << endl;
+        }
+    }
+    return mismatches;
+}
+
+
+template<class F>
+double best_of(const int& runs, const size_t& evaluations, double& checksum, const F& f) {
+    double best = 1e100;
+    for (int i = 0; i < runs; i++) {
+        double sum = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t j = 0; j < evaluations; j++)
+            sum += f(1.0 + j * 1e-6);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+        checksum = sum;
+    }
+    return best;
+}
+
+
+void measure(const string& text, const size_t& evaluations) {
+    auto formula = parse(text);
+    auto jit = JitFunction::compile(*formula.expr);
+    auto function = jit.function();
+    double eval_sum = 0, jit_sum = 0;
+    double eval_time = best_of(3, evaluations, eval_sum, [&](const double& x) { return formula.expr->eval(x); });
+    double jit_time = best_of(3, evaluations, jit_sum, [&](const double& x) { return function(x); });
+    cout << text << endl
+         << "  eval " << eval_time * 1e9 / evaluations << " ns, jit " << jit_time * 1e9 / evaluations << " ns ("
+         << eval_time / jit_time << "x)" << (jit.native() ? "" : ", interpreter fallback")
+         << (same(eval_sum, jit_sum) ? "" : ", results differ") << endl;
+}
+
+
+// jit_bench [evaluations=2000000]
+int main(int argc, char** argv) {
+    size_t evaluations = argc > 1 ? stoul(argv[1]) : 2000000;
+
+    auto mismatches = differential({
+        "x", "42", "'a' + x", "-x", "+x", "!x", "x + 1 - 2 * x / 3", "(x + 1) * (x - 1) / (x * x + 1)",
+        "x % 3", "x ** 2.5", "2 ** x", "pow(x, x)", "sin(x) + cos(x) * exp(-x) - log(x)",
+        "x == 3", "x != 3", "x < 2", "x <= 2", "x > 2", "x >= 2", "x && x - 1", "x || 0", "!(x > 1 && x < 5)",
+        "((x * 2 + 1) * (x * 3 - 1) + (x - 4) * (x + 4)) / ((x + 1) * (x + 2) - (x * x - 2))",
+        "sin(cos(sin(cos(x))))", "abs(x) + x", "sgn(x) * x"
+    });
+    if (mismatches) {
+        cerr << "jit_bench: " << mismatches << " mismatches between the JIT and Expr::eval" << endl;
+        return 1;
+    }
+    cout << "differential check against Expr::eval: ok" << endl;
+
+    measure("x * x * 0.5 - 3 * x + 2", evaluations);
+    measure("((x * 2 + 1) * (x * 3 - 1) + (x - 4) * (x + 4)) / ((x + 1) * (x + 2) - (x * x - 2))", evaluations);
+    measure("sin(x) * exp(-x * x / 8) + log(x + 10)", evaluations);
+    measure("abs(x - 2) * x + 1", evaluations);
+    return 0;
+}
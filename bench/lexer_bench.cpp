@@ -0,0 +1,115 @@
+#include "../include/lexer/lexer.hpp"
+#include <chrono>
+#include <functional>
+
+
+using namespace std;
+
+
+// Deterministic C-like source of roughly `size` bytes. With `spanning`, block
+// comments, strings and a char literal that contain line breaks are mixed in.
+string generate_source(const size_t& size, const bool& spanning = false) {
+    static const vector<string> lines = {
+        "int counter = 0, limit = 1000;",
+        "double value = 3.1415 * radius ** 2 + offset;",
+        "while (counter <= limit && !done) {",
+        "    if (value >= 10.5 || flag != 0) {",
+        "        print(\"counter value\", counter);",
+        "    } elif (value == 0) {",
+        "        value = sin(angle) * cos(angle) + pow(base, exponent);",
+        "    } else {",
+        "        counter = counter + step - (delta % modulo) / divisor;",
+        "    }",
+        "    char symbol = 'x';",
+        "    counter++;",
+        "}",
+        "return result;"
+    };
+
+    string source;
+    source.reserve(size + 128);
+    static const vector<string> spanning_lines = {
+        "/* block comment\n   with \"quotes\", 'x' and ## inside\n*/",
+        "print(\"string over\n two lines // not a comment\n\");",
+        "char newline = '\n';"
+    };
+    for (size_t i = 0; source.size() < size; i++) {
+        source += lines[i % lines.size()];
+        source.push_back('\n');
+        if (spanning && i % 5 == 0) {
+            source += spanning_lines[i / 5 % spanning_lines.size()];
+            source.push_back('\n');
+        }
+    }
+    return source;
+}
+
+
+bool same_tokens(const TokenList& a, const TokenList& b) {
+    if (a.size() != b.size() || a.symbols->size() != b.symbols->size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (a[i].type != b[i].type || a[i].offset != b[i].offset || a[i].length != b[i].length || a[i].symbol != b[i].symbol)
+            return false;
+    for (Symbol symbol = 0; symbol < a.symbols->size(); symbol++)
+        if (a.symbols->name(symbol) != b.symbols->name(symbol))
+            return false;
+    return true;
+}
+
+
+double measure(const function<TokenList(const string_view&)>& lexer, const string& source, size_t& token_count) {
+    const int runs = 5;
+    double best = 1e100;
+    for (int i = 0; i < runs; i++) {
+        auto start = chrono::steady_clock::now();
+        auto tokens = lexer(source);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+        token_count = tokens.size();
+    }
+    return best;
+}
+
+
+// lexer_bench [megabytes=8] [max threads=hardware threads]
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? stoul(argv[1]) : 8;
+    size_t max_threads = argc > 2 ? stoul(argv[2]) : max(1u, thread::hardware_concurrency());
+    auto source = generate_source(megabytes << 20);
+
+    auto reference = Lexer::parse_legacy(source), tokens = Lexer::parse(source);
+    bool identical = reference.size() == tokens.size();
+    for (size_t i = 0; identical && i < tokens.size(); i++)
+        identical = reference[i].type == tokens[i].type && reference.text(i) == tokens.text(i);
+    if (!identical) {
+        cerr << "lexer_bench: Lexer::parse and Lexer::parse_legacy disagree" << endl;
+        return 1;
+    }
+
+    size_t token_count = 0;
+    double mb = source.size() / double(1 << 20);
+    double legacy = measure(Lexer::parse_legacy, source, token_count);
+    double automaton = measure([](const string_view& input) { return Lexer::parse(input); }, source, token_count);
+
+    cout << "input: " << mb << " MB, " << token_count << " tokens" << endl;
+    cout << "legacy:    " << legacy * 1e3 << " ms, " << mb / legacy << " MB/s" << endl;
+    cout << "automaton: " << automaton * 1e3 << " ms, " << mb / automaton << " MB/s" << endl;
+    cout << "speedup:   " << legacy / automaton << "x" << endl;
+
+    // Chunk boundaries move with the thread count, so each count is checked
+    // against the sequential tokens on input with lines spanning tokens too.
+    auto spanning = generate_source(megabytes << 20, true);
+    auto expected = Lexer::parse(spanning);
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        WorkPool pool(threads);
+        if (!same_tokens(Lexer::parse(spanning, pool), expected) || !same_tokens(Lexer::parse(source, pool), tokens)) {
+            cerr << "lexer_bench: parallel lexing with " << threads << " threads differs from Lexer::parse" << endl;
+            return 1;
+        }
+        double parallel = measure([&](const string_view& input) { return Lexer::parse(input, pool); }, source, token_count);
+        cout << "parallel, " << threads << (threads == 1 ? " thread:  " : " threads: ") << parallel * 1e3 << " ms, "
+             << mb / parallel << " MB/s (" << automaton / parallel << "x)" << endl;
+    }
+    return 0;
+}
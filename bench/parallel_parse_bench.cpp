@@ -0,0 +1,61 @@
+#include "../include/lexer/lexer.hpp"
+#include "../include/syntaxer/syntaxer.hpp"
+#include "../include/visitor.hpp"
+#include "generator.hpp"
+#include <chrono>
+#include <sstream>
+
+
+using namespace std;
+
+
+string print(AST& ast) {
+    ostringstream text;
+    Printer printer(text);
+    ast.accept(printer);
+    return text.str();
+}
+
+
+template<class F>
+double best_of(const int& runs, const F& f) {
+    double best = 1e100;
+    for (int i = 0; i < runs; i++) {
+        auto start = chrono::steady_clock::now();
+        f();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+
+// parallel_parse_bench [functions=6000] [max threads=hardware threads]
+int main(int argc, char** argv) {
+    size_t functions = argc > 1 ? stoul(argv[1]) : 6000;
+    size_t max_threads = argc > 2 ? stoul(argv[2]) : max(1u, thread::hardware_concurrency());
+    auto source = generate_program(functions);
+    auto tokens = Lexer::parse(source);
+
+    auto expected = print(*Syntaxer::parse(tokens));
+    double sequential[2];
+    for (bool arena : {false, true})
+        sequential[arena] = best_of(3, [&] { Syntaxer::parse(tokens, arena ? make_shared<Arena>() : nullptr); });
+    cout << "input: " << tokens.size() << " tokens, " << functions << " functions, " << thread::hardware_concurrency()
+         << " hardware threads" << endl;
+    cout << "sequential: heap " << sequential[0] * 1e3 << " ms, arena " << sequential[1] * 1e3 << " ms" << endl;
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        WorkPool pool(threads);
+        for (bool arena : {false, true}) {
+            if (print(*Syntaxer::parse(tokens, pool, arena ? make_shared<Arena>() : nullptr)) != expected) {
+                cerr << "parallel_parse_bench: " << threads << " threads build a different tree" << endl;
+                return 1;
+            }
+            double time = best_of(3, [&] { Syntaxer::parse(tokens, pool, arena ? make_shared<Arena>() : nullptr); });
+            cout << threads << (threads == 1 ? " thread,  " : " threads, ") << (arena ? "arena: " : "heap:  ")
+                 << time * 1e3 << " ms (" << sequential[arena] / time << "x)" << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "../include/lexer/lexer.hpp"
+#include "../include/syntaxer/syntaxer.hpp"
+#include "../include/stats.hpp"
+#include "generator.hpp"
+#include <chrono>
+
+
+using namespace std;
+
+
+// parse_bench [functions] [heap|arena]
+int main(int argc, char** argv) {
+    size_t functions = argc > 1 ? stoul(argv[1]) : 6000;
+    bool use_arena = argc > 2 && string(argv[2]) == "arena";
+    auto source = generate_program(functions);
+
+    auto before = AllocationCounter::allocations.load();
+    auto start = chrono::steady_clock::now();
+    auto tokens = Lexer::parse(source);
+    chrono::duration<double> lex_time = chrono::steady_clock::now() - start;
+    auto lex_allocations = AllocationCounter::allocations.load() - before;
+
+    before = AllocationCounter::allocations.load();
+    auto before_bytes = AllocationCounter::bytes.load();
+    auto rss_before_parse = peak_rss_kib();
+    start = chrono::steady_clock::now();
+    auto ast = Syntaxer::parse(tokens, use_arena ? make_shared<Arena>() : nullptr);
+    chrono::duration<double> parse_time = chrono::steady_clock::now() - start;
+    auto parse_allocations = AllocationCounter::allocations.load() - before;
+    auto parse_bytes = AllocationCounter::bytes.load() - before_bytes;
+    auto rss_after_parse = peak_rss_kib();
+    auto declarations = ast->declarations.size();
+
+    start = chrono::steady_clock::now();
+    ast.reset();
+    chrono::duration<double> teardown_time = chrono::steady_clock::now() - start;
+
+    before = AllocationCounter::allocations.load();
+    before_bytes = AllocationCounter::bytes.load();
+    start = chrono::steady_clock::now();
+    TokenCursor cursor(source);
+    auto streamed = Syntaxer::parse(cursor, use_arena ? make_shared<Arena>() : nullptr);
+    chrono::duration<double> stream_time = chrono::steady_clock::now() - start;
+    auto stream_allocations = AllocationCounter::allocations.load() - before;
+    auto stream_bytes = AllocationCounter::bytes.load() - before_bytes;
+    if (streamed->declarations.size() != declarations) {
+        cerr << "parse_bench: streaming and batch parse disagree" << endl;
+        return 1;
+    }
+
+    cout << "input: " << source.size() << " bytes, " << tokens.size() << " tokens, "
+         << declarations << " declarations, " << (use_arena ? "arena" : "heap") << " nodes" << endl;
+    cout << "lex:   " << lex_time.count() * 1e3 << " ms, " << lex_allocations << " allocations" << endl;
+    cout << "parse: " << parse_time.count() * 1e3 << " ms, " << parse_allocations << " allocations ("
+         << double(parse_allocations) / tokens.size() << " per token), " << parse_bytes / 1024 << " KiB, peak RSS +"
+         << rss_after_parse - rss_before_parse << " KiB" << endl;
+    cout << "teardown: " << teardown_time.count() * 1e3 << " ms" << endl;
+    cout << "lex+parse streaming: " << stream_time.count() * 1e3 << " ms, " << stream_allocations << " allocations, "
+         << stream_bytes / 1024 << " KiB (tokens: " << tokens.size() * sizeof(Token) / 1024 << " KiB when materialized)" << endl;
+    return 0;
+}
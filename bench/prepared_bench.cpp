@@ -0,0 +1,105 @@
+#include "../include/interpreter.hpp"
+#include "../include/prepared.hpp"
+#include "../include/work_pool.hpp"
+#include <chrono>
+#include <sstream>
+
+
+using namespace std;
+
+
+// A request handler sized like the scripts that are run once per input:
+// a few helpers, a short loop and formatted output.
+const string script =
+    "double rate = 0.0725;\n"
+    "int rounds = 12;\n"
+    "double clamp(double x, double low, double high) {\n"
+    "    if (x < low) {\n"
+    "        return low;\n"
+    "    } elif (x > high) {\n"
+    "        return high;\n"
+    "    }\n"
+    "    return x;\n"
+    "}\n"
+    "double grow(double amount, int n) {\n"
+    "    int i = 0;\n"
+    "    while (i < n) {\n"
+    "        amount = amount * (1 + rate);\n"
+    "        i++;\n"
+    "    }\n"
+    "    return amount;\n"
+    "}\n"
+    "int main() {\n"
+    "    double amount = read();\n"
+    "    int years = read();\n"
+    "    double total = clamp(grow(amount, years), 0, 1000000);\n"
+    "    printf(\"%.2f after %d years\\n\", total, years);\n"
+    "    return years % rounds;\n"
+    "}\n";
+
+
+string input(const size_t& i) {
+    return to_string(100 + i % 900) + " " + to_string(i % 30) + "\n";
+}
+
+
+template<class F>
+double per_run(const size_t& runs, const F& f) {
+    double best = 1e100;
+    for (int round = 0; round < 3; round++) {
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < runs; i++)
+            f(i);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count() / runs);
+    }
+    return best;
+}
+
+
+// prepared_bench [runs=20000] [threads=hardware threads]
+int main(int argc, char** argv) {
+    size_t runs = argc > 1 ? stoul(argv[1]) : 20000;
+    size_t threads = argc > 2 ? stoul(argv[2]) : max(1u, thread::hardware_concurrency());
+
+    auto prepared = PreparedProgram::compile(script);
+    vector<string> expected(runs);
+    for (size_t i = 0; i < runs; i++) {
+        int result;
+        expected[i] = prepared.run(input(i), result);
+    }
+
+    // from source every time: read, lex, parse, check, compile, run
+    double cold = per_run(runs / 10, [&](size_t i) {
+        istringstream in(input(i));
+        ostringstream out;
+        auto program = PreparedProgram::compile(script);
+        program.run(out, in);
+        if (out.str() != expected[i])
+            throw runtime_error("prepared_bench: compiling per run gives different output");
+    });
+    double warm = per_run(runs, [&](size_t i) {
+        istringstream in(input(i));
+        ostringstream out;
+        prepared.run(out, in);
+    });
+
+    // one handle shared by every worker
+    WorkPool pool(threads);
+    vector<string> outputs(runs);
+    auto start = chrono::steady_clock::now();
+    pool.run(runs, [&](size_t i, size_t) {
+        int result;
+        outputs[i] = prepared.run(input(i), result);
+    });
+    chrono::duration<double> concurrent = chrono::steady_clock::now() - start;
+    if (outputs != expected) {
+        cerr << "prepared_bench: concurrent runs give different output" << endl;
+        return 1;
+    }
+
+    cout << "compile + run: " << cold * 1e6 << " us/run" << endl;
+    cout << "prepared run:  " << warm * 1e6 << " us/run (" << cold / warm << "x)" << endl;
+    cout << "prepared, " << threads << " threads: " << concurrent.count() / runs * 1e6 << " us/run" << endl;
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "../include/interpreter.hpp"
+#include "../include/work_pool.hpp"
+#include <chrono>
+#include <sstream>
+
+
+using namespace std;
+
+
+// Script `k`: globals, recursion, mixed int/double arithmetic, printf and print.
+string script(const size_t& k) {
+    auto n = to_string(k);
+    return "int counter = " + n + ";\n"
+           "double scale = " + n + ".5;\n"
+           "int fib(int n) {\n"
+           "    if (n < 2) {\n"
+           "        return n;\n"
+           "    }\n"
+           "    return fib(n - 1) + fib(n - 2);\n"
+           "}\n"
+           "double mean(int a, int b) {\n"
+           "    return (a + b) / 2.0;\n"
+           "}\n"
+           "int main() {\n"
+           "    int i = 0, sum = 0;\n"
+           "    while (i < " + to_string(200 + k * 13 % 800) + ") {\n"
+           "        if (i % 3 == 0) {\n"
+           "            sum = sum + i;\n"
+           "        } elif (i % 3 == 1) {\n"
+           "            int t = i * counter;\n"
+           "            sum = sum - t % 17;\n"
+           "        } else {\n"
+           "            counter++;\n"
+           "        }\n"
+           "        i++;\n"
+           "    }\n"
+           "    printf(\"script %d: fib %d, sum %d, mean %.3f\\n\", " + n + ", fib(" + to_string(k % 18) + "), sum, mean(" + n + ", sum));\n"
+           "    print(\"counter\", counter, scale * 2, sin(scale));\n"
+           "    return sum % 256;\n"
+           "}\n";
+}
+
+
+struct Result {
+    string ast;
+    string output;
+    int exit_code = 0;
+
+    bool operator==(const Result&) const = default;
+};
+
+
+// Every third script parses with an arena and every other one streams its tokens.
+Result run(const size_t& k) {
+    Interpreter interpreter("<script " + to_string(k) + ">", k % 3 == 0);
+    interpreter.load_source(script(k));
+    if (k % 2) {
+        interpreter.parse_stream();
+    } else {
+        interpreter.parse_source();
+        interpreter.parse_syntax();
+    }
+    Result result;
+    ostringstream ast, output;
+    interpreter.print_ast(ast);
+    interpreter.compile();
+    result.exit_code = interpreter.run(output);
+    result.ast = ast.str();
+    result.output = output.str();
+    return result;
+}
+
+
+// reentrancy_bench [scripts=400] [threads=max(8, hardware threads)] [rounds=3]
+int main(int argc, char** argv) {
+    size_t scripts = argc > 1 ? stoul(argv[1]) : 400;
+    size_t threads = argc > 2 ? stoul(argv[2]) : max(8u, thread::hardware_concurrency());
+    int rounds = argc > 3 ? stoi(argv[3]) : 3;
+
+    vector<Result> expected(scripts);
+    auto start = chrono::steady_clock::now();
+    for (size_t k = 0; k < scripts; k++)
+        expected[k] = run(k);
+    chrono::duration<double> serial = chrono::steady_clock::now() - start;
+
+    WorkPool pool(threads);
+    double parallel = 1e100;
+    for (int round = 0; round < rounds; round++) {
+        vector<Result> results(scripts);
+        start = chrono::steady_clock::now();
+        pool.run(scripts, [&](size_t k, size_t) { results[k] = run(k); });
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        parallel = min(parallel, elapsed.count());
+
+        for (size_t k = 0; k < scripts; k++) {
+            if (results[k] == expected[k])
+                continue;
+            cerr << "reentrancy_bench: script " << k << " differs from its serial run in round " << round << endl
+                 << "serial:" << endl << expected[k].output << "parallel:" << endl << results[k].output;
+            return 1;
+        }
+    }
+
+    cout << scripts << " interpreters, " << threads << " threads, " << rounds << " rounds: outputs match serial runs" << endl;
+    cout << "serial:   " << serial.count() * 1e3 << " ms" << endl;
+    cout << "parallel: " << parallel * 1e3 << " ms (" << serial.count() / parallel << "x, "
+         << thread::hardware_concurrency() << " hardware threads)" << endl;
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include "../include/lexer/lexer.hpp"
+#include "../include/syntaxer/syntaxer.hpp"
+#include "../include/stats.hpp"
+#include "../include/syntaxer/flat_tree.hpp"
+#include "../include/visitor.hpp"
+#include "generator.hpp"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+
+using namespace std;
+
+
+// One timed call: wall time and the allocations made during it.
+struct Sample {
+    double seconds = 1e100;
+    size_t allocations = 0, bytes = 0;
+};
+
+template<class F>
+Sample sample(const F& f) {
+    auto count = AllocationCounter::allocations.load(), bytes = AllocationCounter::bytes.load();
+    auto start = chrono::steady_clock::now();
+    f();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return {elapsed.count(), AllocationCounter::allocations.load() - count, AllocationCounter::bytes.load() - bytes};
+}
+
+
+// Best of `runs` samples; `setup` runs untimed before each one.
+template<class Setup, class F>
+Sample best_of(const int& runs, const Setup& setup, const F& f) {
+    Sample best;
+    for (int i = 0; i < runs; i++) {
+        setup();
+        auto current = sample(f);
+        if (current.seconds < best.seconds)
+            best = current;
+    }
+    return best;
+}
+
+
+struct Result {
+    string name;
+    Sample sample;
+    double bytes = 0, tokens = 0, nodes = 0; // processed per run; 0 where the rate means nothing
+};
+
+
+size_t count_nodes(const Expr& expr) {
+    size_t count = 1;
+    for (auto& it : expr.branches)
+        count += count_nodes(*it);
+    return count;
+}
+
+
+string json_number(const double& value) {
+    ostringstream text;
+    text.precision(6);
+    text << value;
+    return text.str();
+}
+
+
+void write_json(ostream& out, const GeneratorOptions& options, const int& runs, const vector<Result>& results) {
+    out << "{\n  \"options\": {\"functions\": " << options.functions << ", \"depth\": " << options.depth
+        << ", \"expression_size\": " << options.expression_size << ", \"identifiers\": " << options.identifiers
+        << ", \"seed\": " << options.seed << ", \"runs\": " << runs << "},\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& result = results[i];
+        double seconds = result.sample.seconds;
+        out << "    {\"name\": \"" << result.name << "\", \"seconds\": " << json_number(seconds);
+        if (result.bytes)
+            out << ", \"mb_per_s\": " << json_number(result.bytes / seconds / 1e6);
+        if (result.tokens)
+            out << ", \"tokens_per_s\": " << json_number(result.tokens / seconds);
+        if (result.nodes)
+            out << ", \"nodes_per_s\": " << json_number(result.nodes / seconds);
+        out << ", \"allocations\": " << result.sample.allocations << ", \"allocated_bytes\": " << result.sample.bytes
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+
+void write_table(ostream& out, const vector<Result>& results) {
+    for (const auto& result : results) {
+        double seconds = result.sample.seconds;
+        out << result.name << ": " << seconds * 1e3 << " ms";
+        if (result.bytes)
+            out << ", " << result.bytes / seconds / 1e6 << " MB/s";
+        if (result.tokens)
+            out << ", " << result.tokens / seconds / 1e6 << " M tokens/s";
+        if (result.nodes)
+            out << ", " << result.nodes / seconds / 1e6 << " M nodes/s";
+        out << ", " << result.sample.allocations << " allocations (" << result.sample.bytes / 1024 << " KB)" << endl;
+    }
+}
+
+
+// suite_bench [--functions=N] [--depth=N] [--expression-size=N] [--identifiers=N] [--seed=N] [--runs=N] [--json[=file]]
+int main(int argc, char** argv) {
+    GeneratorOptions options;
+    int runs = 5;
+    string json;
+    bool as_json = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        auto equals = arg.find('=');
+        auto name = arg.substr(0, equals), value = equals == string::npos ? "" : arg.substr(equals + 1);
+        if (name == "--json") {
+            as_json = true;
+            json = value;
+        } else if (value.empty()) {
+            cerr << "suite_bench: Unknown argument " << arg << endl;
+            return 1;
+        } else if (name == "--functions") {
+            options.functions = stoul(value);
+        } else if (name == "--depth") {
+            options.depth = stoul(value);
+        } else if (name == "--expression-size") {
+            options.expression_size = stoul(value);
+        } else if (name == "--identifiers") {
+            options.identifiers = stoul(value);
+        } else if (name == "--seed") {
+            options.seed = stoull(value);
+        } else if (name == "--runs") {
+            runs = stoi(value);
+        } else {
+            cerr << "suite_bench: Unknown argument " << arg << endl;
+            return 1;
+        }
+    }
+
+    auto source = generate_program(options);
+    auto tokens = Lexer::parse(source);
+    auto nodes = FlatAST::from(*Syntaxer::parse(tokens)).size();
+    auto none = [] {};
+    vector<Result> results;
+
+    results.push_back({"lex", best_of(runs, none, [&] { Lexer::parse(source); }), double(source.size()),
+                       double(tokens.size())});
+
+    unique_ptr<AST> ast;
+    for (bool arena : {false, true}) {
+        auto make_arena = [&] { return arena ? make_shared<Arena>() : nullptr; };
+        results.push_back({arena ? "parse_arena" : "parse_heap",
+                           best_of(runs, [&] { ast.reset(); }, [&] { ast = Syntaxer::parse(tokens, make_arena()); }),
+                           0, double(tokens.size()), double(nodes)});
+        results.push_back({arena ? "teardown_arena" : "teardown_heap",
+                           best_of(runs, [&] { ast = Syntaxer::parse(tokens, make_arena()); }, [&] { ast.reset(); }),
+                           0, 0, double(nodes)});
+    }
+
+    ast = Syntaxer::parse(tokens);
+    ostringstream printed;
+    results.push_back({"print", best_of(runs, [&] { printed.str(""); }, [&] {
+        Printer printer(printed);
+        ast->accept(printer);
+    }), 0, 0, double(nodes)});
+    results.back().bytes = printed.str().size();
+
+    // every function's return expression, at `points` values of x
+    vector<const Expr*> expressions;
+    size_t expression_nodes = 0;
+    for (const auto& declaration : ast->declarations) {
+        auto def = dynamic_cast<const FuncDef*>(declaration.get());
+        if (!def || def->block->statements.empty())
+            continue;
+        if (auto ret = dynamic_cast<const Return*>(def->block->statements.back().get()); ret && ret->ret_expr) {
+            expressions.push_back(ret->ret_expr.get());
+            expression_nodes += count_nodes(*ret->ret_expr);
+        }
+    }
+    const int points = 16;
+    volatile double checksum = 0;
+    results.push_back({"eval", best_of(runs, none, [&] {
+        double sum = 0;
+        for (int i = 0; i < points; i++)
+            for (auto expr : expressions)
+                sum += expr->eval(0.25 + i * 0.125);
+        checksum = sum;
+    }), 0, 0, double(expression_nodes * points)});
+
+    if (!as_json) {
+        cout << "input: " << source.size() / 1024 << " KB, " << tokens.size() << " tokens, " << nodes << " nodes, "
+             << tokens.symbols->size() << " symbols" << endl;
+        write_table(cout, results);
+    } else if (json.empty()) {
+        write_json(cout, options, runs, results);
+    } else {
+        ofstream fout(json);
+        write_json(fout, options, runs, results);
+        if (!fout) {
+            cerr << "suite_bench: Cannot write " << json << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
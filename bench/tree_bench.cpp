@@ -0,0 +1,90 @@
+#include "../include/syntaxer/syntaxer.hpp"
+#include "../include/stats.hpp"
+#include "../include/syntaxer/flat_tree.hpp"
+#include "../include/visitor.hpp"
+#include "generator.hpp"
+#include <chrono>
+#include <sstream>
+
+
+using namespace std;
+
+
+// Counts nodes per NodeType over a FlatAST, as NodeCounter does over the tree.
+class FlatNodeCounter : public FlatConstVisitor {
+public:
+    size_t counts[9] = {};
+
+    void visit_children(const FlatAST& ast, const FlatAST::Index& node) {
+        counts[ast.kinds[node]]++;
+        for (uint32_t i = 0; i < ast.count[node]; i++)
+            ast.accept(*this, ast.child(node, i));
+    }
+
+    virtual void visit_root(const FlatAST& ast) override {
+        for (auto it : ast.roots)
+            ast.accept(*this, it);
+    }
+    virtual void visit_var_declaration(const FlatAST& ast, const FlatAST::Index& node) override { visit_children(ast, node); }
+    virtual void visit_func_prot(const FlatAST& ast, const FlatAST::Index& node) override { visit_children(ast, node); }
+    virtual void visit_func_def(const FlatAST& ast, const FlatAST::Index& node) override { visit_children(ast, node); }
+    virtual void visit_block(const FlatAST& ast, const FlatAST::Index& node) override { visit_children(ast, node); }
+    virtual void visit_expr(const FlatAST& ast, const FlatAST::Index& node) override { visit_children(ast, node); }
+    virtual void visit_conditional(const FlatAST& ast, const FlatAST::Index& node) override { visit_children(ast, node); }
+    virtual void visit_loop(const FlatAST& ast, const FlatAST::Index& node) override { visit_children(ast, node); }
+    virtual void visit_return(const FlatAST& ast, const FlatAST::Index& node) override { visit_children(ast, node); }
+    virtual void visit_jump(const FlatAST& ast, const FlatAST::Index& node) override { visit_children(ast, node); }
+};
+
+
+template<class Walk>
+double best_of(const int& runs, const Walk& walk) {
+    double best = 1e100;
+    for (int i = 0; i < runs; i++) {
+        auto start = chrono::steady_clock::now();
+        walk();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+
+int main(int argc, char** argv) {
+    size_t functions = argc > 1 ? stoul(argv[1]) : 6000;
+    const int runs = 5;
+    auto source = generate_program(functions);
+    auto tokens = Lexer::parse(source);
+
+    auto before = AllocationCounter::bytes.load();
+    auto ast = Syntaxer::parse(tokens);
+    auto tree_bytes = AllocationCounter::bytes.load() - before;
+    auto flat = FlatAST::from(*ast);
+
+    ostringstream tree_out, flat_out;
+    Printer printer(tree_out);
+    ast->accept(printer);
+    FlatPrinter flat_printer(flat_out);
+    flat.accept(flat_printer);
+    if (tree_out.str() != flat_out.str()) {
+        cerr << "tree_bench: Printer and FlatPrinter output differ" << endl;
+        return 1;
+    }
+
+    NodeCounter counter;
+    FlatNodeCounter flat_counter;
+    double count_tree = best_of(runs, [&] { counter = NodeCounter(); ast->accept(counter); });
+    double count_flat = best_of(runs, [&] { flat_counter = FlatNodeCounter(); flat.accept(flat_counter); });
+
+    ostringstream sink;
+    double print_tree = best_of(runs, [&] { sink.str(""); Printer p(sink); ast->accept(p); });
+    double print_flat = best_of(runs, [&] { sink.str(""); FlatPrinter p(sink); flat.accept(p); });
+
+    cout << "nodes: " << flat.size() << endl;
+    cout << "memory:  tree " << tree_bytes / 1024 << " KiB, flat " << flat.memory() / 1024 << " KiB" << endl;
+    cout << "count:   tree " << count_tree * 1e3 << " ms, flat " << count_flat * 1e3 << " ms ("
+         << count_tree / count_flat << "x)" << endl;
+    cout << "print:   tree " << print_tree * 1e3 << " ms, flat " << print_flat * 1e3 << " ms ("
+         << print_tree / print_flat << "x)" << endl;
+    return 0;
+}
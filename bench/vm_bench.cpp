@@ -0,0 +1,81 @@
+#include "../include/lexer/lexer.hpp"
+#include "../include/syntaxer/syntaxer.hpp"
+#include "../include/vm/compiler.hpp"
+#include "../include/vm/vm.hpp"
+#include <chrono>
+
+
+using namespace std;
+
+
+// The while/if shape of text.txt, scaled up to `iterations` loop turns.
+string loop_program(const size_t& iterations) {
+    return "int main() {\n"
+           "    int x = 0;\n"
+           "    int sum = 0;\n"
+           "    while (x < " + to_string(iterations) + ") {\n"
+           "        if (x % 3 == 0) {\n"
+           "            sum = sum + x;\n"
+           "        } elif (x % 3 == 1) {\n"
+           "            sum = sum - 1;\n"
+           "        } else {\n"
+           "            int y = 15;\n"
+           "            sum = sum + y;\n"
+           "        }\n"
+           "        x = x + 1;\n"
+           "    }\n"
+           "    return sum % 256;\n"
+           "}\n";
+}
+
+
+string call_program(const size_t& n) {
+    return "int fib(int n) {\n"
+           "    if (n < 2) {\n"
+           "        return n;\n"
+           "    }\n"
+           "    return fib(n - 1) + fib(n - 2);\n"
+           "}\n"
+           "int main() {\n"
+           "    return fib(" + to_string(n) + ") % 256;\n"
+           "}\n";
+}
+
+
+void measure(const string& name, const string& source, const double& units, const string& unit) {
+    auto tokens = Lexer::parse(source);
+    auto ast = Syntaxer::parse(tokens);
+    auto start = chrono::steady_clock::now();
+    auto program = Compiler::compile(*ast);
+    chrono::duration<double> compile_time = chrono::steady_clock::now() - start;
+
+    double best = 1e100;
+    int result = 0;
+    for (int i = 0; i < 3; i++) {
+        VM vm(program);
+        start = chrono::steady_clock::now();
+        result = vm.run();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    cout << name << ": compile " << compile_time.count() * 1e6 << " us, run " << best * 1e3 << " ms, "
+         << best * 1e9 / units << " ns/" << unit << " (exit " << result << ")" << endl;
+}
+
+
+// vm_bench [loop iterations=10000000] [fib n=27]
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? stoul(argv[1]) : 10000000;
+    size_t n = argc > 2 ? stoul(argv[2]) : 27;
+
+    measure("loop", loop_program(iterations), iterations, "iteration");
+    double calls = 0, a = 1, b = 1; // fib(n) makes 2 * fib(n + 1) - 1 calls
+    for (size_t i = 1; i <= n; i++) {
+        double c = a + b;
+        a = b;
+        b = c;
+    }
+    calls = 2 * a - 1;
+    measure("fib", call_program(n), calls, "call");
+    return 0;
+}
@@ -0,0 +1,69 @@
+// Replaces the global operator new so that AllocationCounter sees every heap
+// allocation of the process. Built as the allocation_counter object library and
+// linked into the executables that count allocations, not into proglang, so a
+// program embedding the library keeps its own operator new.
+#include "stats.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+
+namespace {
+
+
+void* allocate(const size_t& size) {
+    AllocationCounter::allocations.fetch_add(1, memory_order_relaxed);
+    AllocationCounter::bytes.fetch_add(size, memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+
+void* allocate(const size_t& size, const align_val_t& alignment) {
+    AllocationCounter::allocations.fetch_add(1, memory_order_relaxed);
+    AllocationCounter::bytes.fetch_add(size, memory_order_relaxed);
+    size_t align = max(size_t(alignment), sizeof(void*));
+    return aligned_alloc(align, (max<size_t>(size, 1) + align - 1) & ~(align - 1));
+}
+
+
+const bool enabled = (AllocationCounter::enabled = true);
+
+
+}
+
+
+void* operator new(size_t size) {
+    if (void* ptr = allocate(size))
+        return ptr;
+    throw bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    if (void* ptr = allocate(size))
+        return ptr;
+    throw bad_alloc();
+}
+
+void* operator new(size_t size, align_val_t alignment) {
+    if (void* ptr = allocate(size, alignment))
+        return ptr;
+    throw bad_alloc();
+}
+
+void* operator new[](size_t size, align_val_t alignment) {
+    if (void* ptr = allocate(size, alignment))
+        return ptr;
+    throw bad_alloc();
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const nothrow_t&) noexcept { return allocate(size); }
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, align_val_t) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t, align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t, align_val_t) noexcept { free(ptr); }
@@ -1,28 +1,105 @@
 #include "interpreter.hpp"
+#include "lexer/source_map.hpp"
 
 
-Interpreter::Interpreter(const string& file_name) : file_name(file_name) {}
+Interpreter::Interpreter(const string& file_name, const bool& use_arena)
+    : file_name(file_name),
+      arena(use_arena ? make_shared<Arena>() : nullptr) {}
+
+
+void Interpreter::load_source(string source) {
+    source_code = move(source);
+    source_loaded = true;
+    file_name.clear(); // names the program's source in tools such as perf
+}
+
+
+void Interpreter::read_source() {
+    if (source_loaded)
+        return;
+    Stats::Scope scope(collected, Stats::READ);
+    source_code = read_source_file(file_name);
+    collected.bytes_read += source_code.size();
+}
 
 
 void Interpreter::parse_source() {
-    ifstream fin(file_name, ios::in);
-    if (fin.is_open()) {
-        string line;
-        while (getline(fin, line)) {
-            for (const auto& it : Lexer::parse(line))
-                tokens.push_back(it);
-        }
-    }
-    fin.close();
+    read_source();
+    Stats::Scope scope(collected, Stats::LEX);
+    tokens = Lexer::parse(source_code);
+    collected.tokens = tokens.size();
+    collected.symbols = tokens.symbols->size();
 }
 
 
 void Interpreter::parse_syntax() {
-    ast_root = Syntaxer::parse(tokens);
+    Stats::Scope scope(collected, Stats::PARSE);
+    ast_root = Syntaxer::parse(tokens, arena);
 }
 
 
-void Interpreter::print_ast() const {
-    Printer printer;
+void Interpreter::parse_stream() {
+    read_source();
+    Stats::Scope scope(collected, Stats::PARSE);
+    TokenCursor cursor(source_code);
+    ast_root = Syntaxer::parse(cursor, arena);
+    collected.symbols = ast_root->symbols->size();
+}
+
+
+void Interpreter::print_ast(ostream& out) {
+    Stats::Scope scope(collected, Stats::PRINT);
+    Printer printer(out);
     ast_root->accept(printer);
 }
+
+
+void Interpreter::print_bytecode(ostream& out) {
+    Stats::Scope scope(collected, Stats::PRINT);
+    program.disassemble(out);
+}
+
+
+void Interpreter::compile() {
+    {
+        Stats::Scope scope(collected, Stats::FOLD);
+        Folder::fold(*ast_root);
+    }
+    {
+        Stats::Scope scope(collected, Stats::CHECK);
+        TypeChecker::check(*ast_root);
+    }
+    Stats::Scope scope(collected, Stats::COMPILE);
+    program = Compiler::generate(*ast_root);
+    program.source_name = file_name;
+}
+
+
+int Interpreter::run(ostream& out) {
+    Stats::Scope scope(collected, Stats::RUN);
+    VM vm(program, out);
+    return vm.run();
+}
+
+
+int Interpreter::run(Profiler& profiler, ostream& out) {
+    Stats::Scope scope(collected, Stats::RUN);
+    VM vm(program, out);
+    return vm.run(profiler);
+}
+
+
+Stats Interpreter::stats() const {
+    Stats stats = collected;
+    if (ast_root) {
+        NodeCounter counter;
+        ast_root->accept(counter);
+        copy(begin(counter.counts), end(counter.counts), stats.nodes);
+    }
+    stats.functions = program.functions.size();
+    for (const auto& it : program.functions)
+        stats.instructions += it.code.size();
+    stats.peak_rss_kib = peak_rss_kib();
+    stats.counts_allocations = AllocationCounter::enabled;
+    return stats;
+}
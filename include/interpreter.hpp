@@ -3,7 +3,12 @@
 
 #include "lexer/lexer.hpp"
 #include "syntaxer/syntaxer.hpp"
+#include "syntaxer/folder.hpp"
+#include "syntaxer/type_checker.hpp"
 #include "visitor.hpp"
+#include "vm/compiler.hpp"
+#include "vm/vm.hpp"
+#include "stats.hpp"
 #include <fstream>
 
 
@@ -14,14 +19,37 @@ class Interpreter {
 private:
     string file_name;
     string source_code;
-    vector<Token> tokens;
+    bool source_loaded = false;
+    TokenList tokens;
+    shared_ptr<Arena> arena; // null unless AST nodes are arena allocated
     unique_ptr<AST> ast_root;
+    Program program;
+    Stats collected;
+
+    void read_source();
 
 public:
-    Interpreter(const string&);
+    // "-" reads the program from standard input
+    Interpreter(const string&, const bool& use_arena = false);
 
+    // Uses the given program text instead of reading the file.
+    void load_source(string);
     void parse_source();
     void parse_syntax();
-    void print_ast() const;
+    // Reads the source and parses it with tokens lexed on demand instead of parse_source + parse_syntax.
+    void parse_stream();
+    void print_ast(ostream& = cout);
+    void print_bytecode(ostream& = cout);
+    void compile();
+    // Runs main and returns its result; the program's output goes to `out`.
+    int run(ostream& out = cout);
+    // run() with the profiler sampling it.
+    int run(Profiler&, ostream& out = cout);
+    // The program text, for mapping offsets in the tree and bytecode to lines.
+    const string& source() const { return source_code; }
+    // The program compile() produced.
+    const Program& bytecode() const { return program; }
+    // Time and allocations of every phase so far, with counts of what each produced.
+    Stats stats() const;
 };
 
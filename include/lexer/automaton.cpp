@@ -0,0 +1,232 @@
+#include "automaton.hpp"
+#include "dictionary.hpp"
+#include <string_view>
+
+
+struct Lexer::Automaton::Dfa {
+    static const int max_states = 64;
+    static const uint8_t reject = 0; // the start state is never a transition target
+
+    array<uint8_t, 256> columns; // metachar -> column, 0xff for other chars
+    array<array<uint8_t, 20>, max_states> transitions;
+    array<int8_t, max_states> accepting; // TokenType or -1
+};
+
+
+namespace {
+    struct Operator {
+        string_view text;
+        Token::TokenType type;
+    };
+
+    // Adding an operator only requires a new row here, the DFA is rebuilt at compile time.
+    constexpr Operator operator_list[] = {
+        {"+", Token::PLUS},
+        {"-", Token::MINUS},
+        {"*", Token::ASTERISK},
+        {"/", Token::SLASH},
+        {"//", Token::INLINECOMMENT},
+        {"/*", Token::BLOCKCOMMENTSTART},
+        {"++", Token::INCREMENT},
+        {"--", Token::DECREMENT},
+        {"==", Token::EQUAL},
+        {"!=", Token::NOTEQUAL},
+        {">", Token::COMPARISON},
+        {">=", Token::COMPARISON},
+        {"<", Token::COMPARISON},
+        {"<=", Token::COMPARISON},
+        {"=", Token::ASSIGNMENT},
+        {"!", Token::NOT},
+        {"%", Token::MODULO},
+        {"**", Token::POWER},
+        {"||", Token::LOGIC_OR},
+        {"&&", Token::LOGIC_AND},
+        {"&", Token::AMPERSAND},
+        {"|", Token::VERTICALBAR},
+        {"(", Token::LPAREN},
+        {")", Token::RPAREN},
+        {"[", Token::LSQUAREBRACKET},
+        {"]", Token::RSQUAREBRACKET},
+        {"{", Token::LCURLYBRACKET},
+        {"}", Token::RCURLYBRACKET},
+        {",", Token::COMMA},
+        {".", Token::DOT},
+        {";", Token::SEMICOLON}
+    };
+
+    constexpr string_view metachars = "+-*/=<>%!(){}[]&|,;.";
+}
+
+
+const array<Lexer::Automaton::CharClass, 256> Lexer::Automaton::char_classes = [] {
+    array<CharClass, 256> table{};
+    for (int c = 'A'; c <= 'Z'; c++)
+        table[c] = LITERAL;
+    for (int c = 'a'; c <= 'z'; c++)
+        table[c] = LITERAL;
+    table['_'] = LITERAL;
+    for (int c = '0'; c <= '9'; c++)
+        table[c] = DIGIT;
+    for (auto c : string_view(" \t\n"))
+        table[static_cast<unsigned char>(c)] = SPACE;
+    for (auto c : metachars)
+        table[static_cast<unsigned char>(c)] = METACHAR;
+    table['\"'] = QUOTE;
+    table['\''] = APOSTROPHE;
+    return table;
+}();
+
+
+const Lexer::Automaton::Dfa Lexer::Automaton::operators = [] {
+    static_assert(metachars.size() <= 20, "Automaton: too many metachars for the transition table");
+    Dfa dfa{};
+    dfa.columns.fill(0xff);
+    for (size_t i = 0; i < metachars.size(); i++)
+        dfa.columns[static_cast<unsigned char>(metachars[i])] = i;
+    dfa.accepting.fill(-1);
+
+    int states = 1;
+    for (const auto& op : operator_list) {
+        int state = 0;
+        for (auto c : op.text) {
+            auto& next = dfa.transitions[state][dfa.columns[static_cast<unsigned char>(c)]];
+            if (next == Dfa::reject)
+                next = states++;
+            state = next;
+        }
+        dfa.accepting[state] = op.type;
+    }
+    return dfa;
+}();
+
+
+Lexer::Automaton::CharClass Lexer::Automaton::classify(const char& c) {
+    return char_classes[static_cast<unsigned char>(c)];
+}
+
+
+Token Lexer::Automaton::scan_number(const string_view& input, size_t& pos) {
+    auto start = pos, len = input.length();
+    while (pos < len && classify(input[pos]) == DIGIT)
+        pos++;
+    if (pos < len && input[pos] == '.') {
+        pos++;
+        while (pos < len && classify(input[pos]) == DIGIT)
+            pos++;
+    }
+    return Token(Token::NUMBER, start, pos - start);
+}
+
+
+Token Lexer::Automaton::scan_identifier(const string_view& input, size_t& pos, SymbolTable& symbols) {
+    auto start = pos, len = input.length();
+    while (pos < len && classify(input[pos]) == LITERAL)
+        pos++;
+
+    auto identifier = input.substr(start, pos - start);
+    return Token(Dictionary::classify(identifier), start, pos - start, symbols.intern(identifier));
+}
+
+
+Token Lexer::Automaton::scan_string(const string_view& input, size_t& pos) {
+    auto start = ++pos, end = input.find('\"', start);
+    if (end == string_view::npos)
+        end = input.length();
+    pos = min(end + 1, input.length());
+    return Token(Token::STRING, start, end - start);
+}
+
+
+Token::TokenType Lexer::Automaton::scan_metasequence(const string_view& input, size_t& pos) {
+    auto start = pos, len = input.length(), accepted_end = pos;
+    int state = 0, accepted_type = -1;
+    while (pos < len) {
+        auto column = operators.columns[static_cast<unsigned char>(input[pos])];
+        if (column == 0xff)
+            break;
+        auto next = operators.transitions[state][column];
+        if (next == Dfa::reject)
+            break;
+        state = next;
+        pos++;
+        if (operators.accepting[state] >= 0) {
+            accepted_type = operators.accepting[state];
+            accepted_end = pos;
+        }
+    }
+
+    if (accepted_type < 0)
+        throw runtime_error("Lexer::Automaton::scan_metasequence(): Invalid metasequence at " + to_string(start));
+    pos = accepted_end;
+    return static_cast<Token::TokenType>(accepted_type);
+}
+
+
+void Lexer::Automaton::skip_comment(const string_view& input, size_t& pos, const Token::TokenType& type) {
+    if (type == Token::INLINECOMMENT) {
+        auto end = input.find('\n', pos);
+        pos = end == string_view::npos ? input.length() : end + 1;
+    } else {
+        auto end = input.find("*/", pos);
+        if (end == string_view::npos)
+            throw runtime_error("Lexer::Automaton::skip_comment(): Unterminated block comment");
+        pos = end + 2;
+    }
+}
+
+
+bool Lexer::Automaton::next(const string_view& input, size_t& pos, Token& token, SymbolTable& symbols) {
+    auto len = input.length();
+
+    while (pos < len) {
+        auto c = input[pos];
+        switch (classify(c)) {
+            case SPACE:
+                pos++;
+                break;
+            case DIGIT:
+                token = scan_number(input, pos);
+                return true;
+            case LITERAL:
+                token = scan_identifier(input, pos, symbols);
+                return true;
+            case METACHAR: {
+                auto start = pos;
+                auto type = scan_metasequence(input, pos);
+                if (type == Token::INLINECOMMENT || type == Token::BLOCKCOMMENTSTART) {
+                    skip_comment(input, pos, type);
+                    break;
+                }
+                token = Token(type, start, pos - start);
+                return true;
+            }
+            case QUOTE:
+                token = scan_string(input, pos);
+                return true;
+            case APOSTROPHE:
+                token = Token(Token::CHAR, pos + 1, 1);
+                pos += 3;
+                return true;
+            default:
+                throw runtime_error("Invalid char: " + to_string(c));
+        }
+    }
+
+    return false;
+}
+
+
+TokenList Lexer::Automaton::run(const string_view& input) {
+    if (input.length() > UINT32_MAX)
+        throw runtime_error("Lexer::Automaton::run(): Source is larger than 4 GiB");
+
+    TokenList list(input);
+    list.tokens.reserve(input.length() / 4 + 16); // ~4 source bytes per token on typical code
+
+    size_t pos = 0;
+    Token token(Token::NUMBER, 0, 0);
+    while (next(input, pos, token, *list.symbols))
+        list.tokens.push_back(token);
+
+    return list;
+}
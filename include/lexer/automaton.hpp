@@ -0,0 +1,39 @@
+#pragma once
+
+
+#include "lexer.hpp"
+#include <array>
+#include <cstdint>
+
+
+// Table-driven scanner: every byte is classified with one lookup in a
+// 256-entry table, operators are recognized by a DFA built at compile time
+// from the operator list in automaton.cpp.
+class Lexer::Automaton {
+public:
+    enum CharClass : uint8_t {
+        INVALID,
+        SPACE, // ' ', \t, \n
+        LITERAL, // A-Z, a-z, _
+        DIGIT, // 0-9
+        METACHAR, // +-*/=<>%!(){}[]&|,;.
+        QUOTE, // "
+        APOSTROPHE // '
+    };
+
+    static CharClass classify(const char&);
+    static bool next(const string_view&, size_t&, Token&, SymbolTable&);
+    static TokenList run(const string_view&);
+
+private:
+    struct Dfa;
+
+    static const array<CharClass, 256> char_classes;
+    static const Dfa operators;
+
+    static Token scan_number(const string_view&, size_t&);
+    static Token scan_identifier(const string_view&, size_t&, SymbolTable&);
+    static Token scan_string(const string_view&, size_t&);
+    static Token::TokenType scan_metasequence(const string_view&, size_t&);
+    static void skip_comment(const string_view&, size_t&, const Token::TokenType&);
+};
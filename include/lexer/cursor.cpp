@@ -0,0 +1,41 @@
+#include "cursor.hpp"
+
+
+TokenCursor::TokenCursor(const TokenList& list)
+    : source(list.source),
+      symbols(list.symbols),
+      window(list.tokens.data()),
+      count(list.tokens.size()),
+      streaming(false) {}
+
+
+TokenCursor::TokenCursor(const string_view& source, shared_ptr<SymbolTable> symbols)
+    : source(source),
+      symbols(move(symbols)),
+      window(nullptr),
+      streaming(true) {
+    if (source.length() > UINT32_MAX)
+        throw runtime_error("TokenCursor::TokenCursor(): Source is larger than 4 GiB");
+    buffer.reserve(batch + lookbehind + 1);
+}
+
+
+bool TokenCursor::fill(const size_t& i) {
+    if (i < first)
+        throw logic_error("TokenCursor::fill(): Token " + to_string(i) + " was already discarded");
+    if (!streaming)
+        return false;
+
+    auto keep_from = max(first, i > lookbehind ? i - lookbehind : 0);
+    auto discarded = min(keep_from - first, buffer.size());
+    buffer.erase(buffer.begin(), buffer.begin() + discarded);
+    first += discarded;
+
+    Token token(Token::NUMBER, 0, 0);
+    while (first + buffer.size() <= i + batch && Lexer::next(source, source_pos, token, *symbols))
+        buffer.push_back(token);
+
+    window = buffer.data();
+    count = buffer.size();
+    return i - first < count;
+}
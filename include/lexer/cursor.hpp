@@ -0,0 +1,47 @@
+#pragma once
+
+
+#include "lexer.hpp"
+#include <stdexcept>
+
+
+// Random access to tokens by absolute index, either over an already lexed
+// TokenList or lexing the source on demand. In streaming mode only a small
+// window around the last requested index is kept: tokens more than
+// `lookbehind` positions behind it are discarded.
+class TokenCursor {
+public:
+    static const size_t lookbehind = 3;
+    static const size_t batch = 256;
+
+    string_view source;
+    shared_ptr<SymbolTable> symbols;
+
+    TokenCursor(const TokenList&);
+    TokenCursor(const string_view&, shared_ptr<SymbolTable> = make_shared<SymbolTable>());
+
+    const Token& operator[](const size_t& i) {
+        if (i - first >= count && !fill(i))
+            throw out_of_range("TokenCursor: Unexpected end of input");
+        return window[i - first];
+    }
+
+    bool has(const size_t& i) {
+        return i - first < count || fill(i);
+    }
+
+    string_view text(const size_t& i) {
+        const auto& token = (*this)[i];
+        return source.substr(token.offset, token.length);
+    }
+
+private:
+    const Token* window;
+    size_t first = 0, count = 0;
+
+    bool streaming;
+    size_t source_pos = 0;
+    vector<Token> buffer;
+
+    bool fill(const size_t&);
+};
@@ -1,41 +1,84 @@
 #include "dictionary.hpp"
+#include <array>
+#include <cstdint>
 
 
-const vector<string> Lexer::Dictionary::keywords = {
-    "if",
-    "elif",
-    "else",
-    "while",
-    "main",
-    "return",
-    "continue",
-    "break"
+struct Lexer::Dictionary::Word {
+    string_view text;
+    Token::TokenType type;
 };
 
-const vector<string> Lexer::Dictionary::datatypes = {
-    "void",
-    "bool",
-    "int",
-    "double",
-    "char",
-    "string"
-};
 
-const vector<string> Lexer::Dictionary::math_functions = {
-	"pow",
-	"exp",
-	"log",
-	"sin",
-	"cos"
+// Reserved words of the language. Adding a word only requires a new row here,
+// the perfect hash below is recomputed at compile time.
+constexpr Lexer::Dictionary::Word Lexer::Dictionary::word_list[] = {
+    {"if", Token::KEYWORD},
+    {"elif", Token::KEYWORD},
+    {"else", Token::KEYWORD},
+    {"while", Token::KEYWORD},
+    {"main", Token::KEYWORD},
+    {"return", Token::KEYWORD},
+    {"continue", Token::KEYWORD},
+    {"break", Token::KEYWORD},
+
+    {"void", Token::DATATYPE},
+    {"bool", Token::DATATYPE},
+    {"int", Token::DATATYPE},
+    {"double", Token::DATATYPE},
+    {"char", Token::DATATYPE},
+    {"string", Token::DATATYPE},
+
+    {"pow", Token::MATH_FUNC},
+    {"exp", Token::MATH_FUNC},
+    {"log", Token::MATH_FUNC},
+    {"sin", Token::MATH_FUNC},
+    {"cos", Token::MATH_FUNC},
+
+    {"read", Token::BUILTIN_FUNC},
+    {"print", Token::BUILTIN_FUNC},
+    {"abs", Token::BUILTIN_FUNC},
+    {"sgn", Token::BUILTIN_FUNC}
 };
 
-const vector<string> Lexer::Dictionary::builtin_functions = {
-    "read",
-    "print",
-    "abs",
-    "sgn"
+
+struct Lexer::Dictionary::WordTable {
+    static const int bits = 6;
+    static const size_t size = size_t(1) << bits;
+
+    uint32_t seed;
+    array<Word, size> slots;
+
+    // Mixes length, first, second and last char; every word must differ in at least one of them.
+    static constexpr uint32_t hash(const string_view& word, const uint32_t& seed) {
+        auto len = word.length();
+        uint32_t key = uint32_t(uint8_t(word[0])) << 24 | uint32_t(uint8_t(word[len > 1])) << 16 |
+                       uint32_t(uint8_t(word[len - 1])) << 8 | uint32_t(len);
+        return (key * seed) >> (32 - bits);
+    }
+
+    static constexpr WordTable build() {
+        for (uint32_t seed = 1; seed < (1u << 20); seed += 2) {
+            WordTable table{seed, {}};
+            bool collision = false;
+            for (const auto& word : word_list) {
+                auto& slot = table.slots[hash(word.text, seed)];
+                if (!slot.text.empty()) {
+                    collision = true;
+                    break;
+                }
+                slot = word;
+            }
+            if (!collision)
+                return table;
+        }
+        return WordTable{0, {}};
+    }
 };
 
+
+constexpr Lexer::Dictionary::WordTable Lexer::Dictionary::words = WordTable::build();
+
+
 const unordered_map<string, Token::TokenType> Lexer::Dictionary::MetaSequenceAssossiations = {
     {"+", Token::PLUS},
     {"-", Token::MINUS},
@@ -70,23 +113,12 @@ const unordered_map<string, Token::TokenType> Lexer::Dictionary::MetaSequenceAss
 };
 
 
-bool Lexer::Dictionary::iskeyword(const string& token) {
-    return find(keywords.begin(), keywords.end(), token) != keywords.end();
-}
-
-
-bool Lexer::Dictionary::isdatatype(const string& token) {
-    return find(datatypes.begin(), datatypes.end(), token) != datatypes.end();
-}
-
-
-bool Lexer::Dictionary::is_math_function(const string& token) {
-    return find(math_functions.begin(), math_functions.end(), token) != math_functions.end();
-}
-
-
-bool Lexer::Dictionary::is_builtin_function(const string& token) {
-    return find(builtin_functions.begin(), builtin_functions.end(), token) != builtin_functions.end();
+Token::TokenType Lexer::Dictionary::classify(const string_view& token) {
+    static_assert(words.seed != 0, "Lexer::Dictionary: no perfect hash seed found for word_list");
+    if (token.empty())
+        return Token::IDENTIFIER;
+    const auto& slot = words.slots[WordTable::hash(token, words.seed)];
+    return slot.text == token ? slot.type : Token::IDENTIFIER;
 }
 
 
@@ -1,21 +1,21 @@
 #pragma once
 
 #include "lexer.hpp"
+#include <string_view>
 
 
 class Lexer::Dictionary {
 private:
-    static const vector<string> keywords;
-    static const vector<string> datatypes;
-    static const vector<string> math_functions;
-    static const vector<string> builtin_functions;
+    struct Word;
+    struct WordTable;
+
+    static const Word word_list[];
+    static const WordTable words;
 
 public:
     static const unordered_map<string, Token::TokenType> MetaSequenceAssossiations;
 
-    static bool iskeyword(const string&);
-    static bool isdatatype(const string&);
-	static bool is_math_function(const string&);
-	static bool is_builtin_function(const string&);
+    // KEYWORD, DATATYPE, MATH_FUNC, BUILTIN_FUNC or IDENTIFIER in a single hash probe
+    static Token::TokenType classify(const string_view&);
     static bool is_valid_metasequence(const string&);
 };
@@ -1,80 +1,77 @@
 #include "lexer.hpp"
 #include "alphabet.hpp"
 #include "dictionary.hpp"
+#include "automaton.hpp"
 
 
-bool Lexer::blockcomment = false;
-Token::Token(const TokenType& type, const string& value) : type(type), value(value) {}
+static_assert(sizeof(Token) <= 16, "Token must stay a compact slice of the source");
 
 
-Token Lexer::extract_number(const string& input, size_t& pos) {
-	string number;
-	auto len = input.length();
-	for (auto c = input[pos]; pos < len && Alphabet::isdigit(c); number.push_back(c), c = input[++pos]);
-	if (Alphabet::isdot(input[pos])) {
-		number.push_back(input[pos++]);
-		for (auto c = input[pos]; pos < len && Alphabet::isdigit(c); number.push_back(c), c = input[++pos]);
-	}
-	return Token(Token::NUMBER, number);
-}
+Token::Token(const TokenType& type, const size_t& offset, const size_t& length, const Symbol& symbol)
+	: type(type), offset(offset), length(length), symbol(symbol) {}
+
+
+TokenList::TokenList(const string_view& source) : source(source), symbols(make_shared<SymbolTable>()) {}
 
 
-Token Lexer::extract_identifier(const string& input, size_t& pos) {
-    string identifier;
-	auto len = input.length();
-	for (; pos < len; pos++) {
-		auto c = input[pos];
-		if (Alphabet::isliteral(c))
-			identifier.push_back(c);
-		else break;
+Token Lexer::extract_number(const string_view& input, size_t& pos) {
+	auto start = pos, len = input.length();
+	for (; pos < len && Alphabet::isdigit(input[pos]); pos++);
+	if (pos < len && Alphabet::isdot(input[pos])) {
+		pos++;
+		for (; pos < len && Alphabet::isdigit(input[pos]); pos++);
 	}
+	return Token(Token::NUMBER, start, pos - start);
+}
 
-	if (Dictionary::iskeyword(identifier))
-		return Token(Token::KEYWORD, identifier);
-	else if (Dictionary::isdatatype(identifier))
-		return Token(Token::DATATYPE, identifier);
-	else if (Dictionary::is_math_function(identifier))
-		return Token(Token::MATH_FUNC, identifier);
-	else if (Dictionary::is_builtin_function(identifier))
-		return Token(Token::BUILTIN_FUNC, identifier);
-	return Token(Token::IDENTIFIER, identifier);
+
+Token Lexer::extract_identifier(const string_view& input, size_t& pos, SymbolTable& symbols) {
+	auto start = pos, len = input.length();
+	for (; pos < len && Alphabet::isliteral(input[pos]); pos++);
+	auto identifier = input.substr(start, pos - start);
+	return Token(Dictionary::classify(identifier), start, pos - start, symbols.intern(identifier));
 }
 
 
-Token Lexer::extract_string(const string& input, size_t& pos) {
-	pos++;
-	string str;
-	auto len = input.length();
+Token Lexer::extract_string(const string_view& input, size_t& pos) {
+	auto start = ++pos, len = input.length();
 	for(; pos < len; pos++) {
-		auto c = input[pos];
-		if (Alphabet::isquote(c)) {
+		if (Alphabet::isquote(input[pos])) {
 			pos++;
-			break;
+			return Token(Token::STRING, start, pos - 1 - start);
 		}
-		str.push_back(c);
 	}
-	return Token(Token::STRING, str);
+	return Token(Token::STRING, start, pos - start);
 }
 
 
-Token Lexer::extract_metasequence(const string& input, size_t& pos){
+Token Lexer::extract_metasequence(const string_view& input, size_t& pos){
 	string metasequence;
-	auto len = input.length();
-	for (auto c = input[pos]; pos < len && Alphabet::ismetachar(c); c = input[pos]) {
-		metasequence.push_back(c);
+	auto start = pos, len = input.length();
+	for (; pos < len && Alphabet::ismetachar(input[pos]); pos++) {
+		metasequence.push_back(input[pos]);
 		if (!Dictionary::is_valid_metasequence(metasequence)) {
 			metasequence.pop_back();
 			break;
 		}
-		pos++;
 	}
-	return Token(Dictionary::MetaSequenceAssossiations.at(metasequence), metasequence);
+	return Token(Dictionary::MetaSequenceAssossiations.at(metasequence), start, pos - start);
 }
 
 
 
-vector<Token> Lexer::parse(const string& input) {
-    vector<Token> tokens;
+TokenList Lexer::parse(const string_view& input) {
+	return Automaton::run(input);
+}
+
+
+bool Lexer::next(const string_view& input, size_t& pos, Token& token, SymbolTable& symbols) {
+	return Automaton::next(input, pos, token, symbols);
+}
+
+
+TokenList Lexer::parse_legacy(const string_view& input) {
+    TokenList tokens(input);
     size_t pos = 0, len = input.length();
 
 	while (pos < len) {
@@ -83,19 +80,16 @@ vector<Token> Lexer::parse(const string& input) {
             pos++;
 		else if (c == '\'') {
 			pos++;
-			tokens.push_back(Token(Token::CHAR, string(1, input[pos])));
+			tokens.tokens.push_back(Token(Token::CHAR, pos, 1));
 			pos += 2;
 		} else if (Alphabet::isdigit(c)) {
-			auto number = extract_number(input, pos);
-			tokens.push_back(number);
+			tokens.tokens.push_back(extract_number(input, pos));
 		} else if (Alphabet::isliteral(c)) {
-			auto identifier = extract_identifier(input, pos);
-			tokens.push_back(identifier);
+			tokens.tokens.push_back(extract_identifier(input, pos, *tokens.symbols));
 		} else if (Alphabet::ismetachar(c)) {
-            auto metasequence = extract_metasequence(input, pos);
-			tokens.push_back(metasequence);
+			tokens.tokens.push_back(extract_metasequence(input, pos));
 		} else if (Alphabet::isquote(c)) {
-			tokens.push_back(extract_string(input, pos));
+			tokens.tokens.push_back(extract_string(input, pos));
 		 } else
             throw runtime_error("Invalid char: " + to_string(c));
     }
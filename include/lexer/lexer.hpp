@@ -6,14 +6,19 @@ using namespace std;
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <cstdint>
 #include <algorithm>
 #include <unordered_map>
+#include <memory>
+#include "symbols.hpp"
+#include "../work_pool.hpp"
 
 
 class Token {
 public:
-    enum TokenType {
+    enum TokenType : uint8_t {
         NUMBER, 
         CHAR, 
         IDENTIFIER, // name of functions, vars, structs etc.
@@ -49,29 +54,55 @@ public:
         COMMA, // ,
         SEMICOLON, // ;
         DOT, // .
-        INLINECOMMENT,
-        BLOCKCOMMENTSTART,
-        BLOCKCOMMENTEND
+        INLINECOMMENT, // //
+        BLOCKCOMMENTSTART, // /*
+        BLOCKCOMMENTEND // */
     };
 
+    // Text is not stored: a token is a slice [offset, offset + length) of the lexed buffer.
+    // Words (identifiers, keywords, type and function names) also carry their interned symbol.
     TokenType type;
-    string value;
+    uint32_t offset;
+    uint32_t length;
+    Symbol symbol;
 
-    Token(const TokenType&, const string&);
+    Token(const TokenType&, const size_t&, const size_t&, const Symbol& = SymbolTable::none);
     string get_type();
 };
 
+
+// Tokens of one source buffer. The buffer is referenced, not owned, and must outlive the list.
+class TokenList {
+public:
+    string_view source;
+    vector<Token> tokens;
+    shared_ptr<SymbolTable> symbols;
+
+    TokenList(const string_view& = {});
+
+    const Token& operator[](const size_t& i) const { return tokens[i]; }
+    size_t size() const { return tokens.size(); }
+    string_view text(const size_t& i) const { return source.substr(tokens[i].offset, tokens[i].length); }
+};
+
+
 class Lexer {
 private:
     class Alphabet;
     class Dictionary;
+    class Automaton;
 
-    static Token extract_number(const string&, size_t&);
-    static Token extract_identifier(const string&, size_t&);
-    static Token extract_string(const string&, size_t&);
-    static Token extract_metasequence(const string&, size_t&);
+    static Token extract_number(const string_view&, size_t&);
+    static Token extract_identifier(const string_view&, size_t&, SymbolTable&);
+    static Token extract_string(const string_view&, size_t&);
+    static Token extract_metasequence(const string_view&, size_t&);
 
 public:
-    static bool blockcomment;
-    static vector<Token> parse(const string&);
+    // Lexes a whole translation unit; comments and strings may span lines.
+    static TokenList parse(const string_view&);
+    // Same tokens and symbols as parse(), lexed in chunks on the pool's workers.
+    static TokenList parse(const string_view&, WorkPool&);
+    static TokenList parse_legacy(const string_view&);
+    // Lexes the next token at or after pos; returns false at the end of input.
+    static bool next(const string_view&, size_t&, Token&, SymbolTable&);
 };
@@ -0,0 +1,140 @@
+#include "lexer.hpp"
+#include "automaton.hpp"
+
+
+// Chunked lexing for Lexer::parse(input, pool). The scanner keeps no state
+// between tokens besides the position, so a chunk lexed from the start of one
+// of its lines gives the sequential tokens as soon as it reaches a position the
+// sequential scan also reaches. Chunks are lexed speculatively in parallel and
+// then stitched in order: when the previous chunk ended past this one's start
+// (a string, block comment or char literal crossing the line break), tokens are
+// lexed on the true path until one ends where a speculative token ended.
+namespace {
+
+
+const size_t min_chunk = 1 << 18;
+const size_t chunks_per_worker = 8; // leaves work to steal when chunks are uneven
+
+
+struct Chunk {
+    size_t begin = 0, end = 0; // bytes where the chunk's tokens start
+    vector<Token> tokens; // speculative, with chunk-local symbols
+    SymbolTable symbols;
+    size_t stop = 0; // scan position after the last token
+    bool failed = false;
+
+    vector<Token> relexed; // true tokens before the chunk synchronized
+    size_t keep = 0; // speculative tokens [keep, size) are kept
+    vector<Symbol> global; // by local symbol
+};
+
+
+// Scan position after `token`: strings and char literals exclude their quotes.
+size_t token_end(const string_view& input, const Token& token) {
+    size_t end = token.offset + token.length;
+    if (token.type == Token::STRING)
+        return min(end + 1, input.length());
+    if (token.type == Token::CHAR)
+        return end + 1;
+    return end;
+}
+
+
+}
+
+
+TokenList Lexer::parse(const string_view& input, WorkPool& pool) {
+    size_t count = min(pool.size() * chunks_per_worker, input.length() / min_chunk);
+    if (count < 2)
+        return parse(input);
+    if (input.length() > UINT32_MAX)
+        throw runtime_error("Lexer::parse(): Source is larger than 4 GiB");
+
+    // chunks begin after a line break
+    vector<size_t> starts{0};
+    for (size_t i = 1; i < count; i++) {
+        auto newline = input.find('\n', max(starts.back(), input.length() * i / count));
+        if (newline == string_view::npos)
+            break;
+        if (newline + 1 < input.length())
+            starts.push_back(newline + 1);
+    }
+    vector<Chunk> chunks(starts.size());
+    for (size_t i = 0; i < chunks.size(); i++) {
+        chunks[i].begin = starts[i];
+        chunks[i].end = i + 1 < starts.size() ? starts[i + 1] : input.length();
+    }
+
+    pool.run(chunks.size(), [&](size_t i, size_t) {
+        auto& chunk = chunks[i];
+        chunk.tokens.reserve((chunk.end - chunk.begin) / 4 + 16);
+        size_t pos = chunk.begin;
+        Token token(Token::NUMBER, 0, 0);
+        try {
+            while (pos < chunk.end && Automaton::next(input, pos, token, chunk.symbols))
+                chunk.tokens.push_back(token);
+        } catch (const exception&) {
+            chunk.failed = true; // may be inside a string or comment on the true path
+        }
+        chunk.stop = pos;
+    });
+
+    TokenList list(input);
+    size_t pos = 0, total = 0;
+    for (auto& chunk : chunks) {
+        auto& tokens = chunk.tokens;
+        bool synced = pos == chunk.begin;
+        while (!synced && pos < chunk.end) {
+            while (chunk.keep < tokens.size() && token_end(input, tokens[chunk.keep]) < pos)
+                chunk.keep++;
+            if (chunk.keep < tokens.size() && token_end(input, tokens[chunk.keep]) == pos) {
+                chunk.keep++;
+                synced = true;
+                break;
+            }
+            Token token(Token::NUMBER, 0, 0);
+            if (!Automaton::next(input, pos, token, chunk.symbols))
+                break;
+            chunk.relexed.push_back(token);
+        }
+        if (!synced)
+            chunk.keep = tokens.size(); // the true scan passed the whole chunk
+        else if (chunk.failed)
+            return parse(input); // the error is on the true path; report it as the sequential lexer does
+        else
+            pos = chunk.stop;
+
+        // symbols are numbered by first occurrence, as the sequential lexer numbers them
+        chunk.global.assign(chunk.symbols.size(), SymbolTable::none);
+        if (chunk.relexed.empty() && chunk.keep == 0) {
+            for (Symbol symbol = 0; symbol < chunk.symbols.size(); symbol++)
+                chunk.global[symbol] = list.symbols->intern(chunk.symbols.name(symbol));
+        } else {
+            auto map = [&](const Token& token) {
+                if (token.symbol != SymbolTable::none && chunk.global[token.symbol] == SymbolTable::none)
+                    chunk.global[token.symbol] = list.symbols->intern(chunk.symbols.name(token.symbol));
+            };
+            for_each(chunk.relexed.begin(), chunk.relexed.end(), map);
+            for_each(tokens.begin() + chunk.keep, tokens.end(), map);
+        }
+        total += chunk.relexed.size() + tokens.size() - chunk.keep;
+    }
+
+    vector<size_t> offsets(chunks.size() + 1);
+    for (size_t i = 0; i < chunks.size(); i++)
+        offsets[i + 1] = offsets[i] + chunks[i].relexed.size() + chunks[i].tokens.size() - chunks[i].keep;
+    list.tokens.assign(total, Token(Token::NUMBER, 0, 0));
+    pool.run(chunks.size(), [&](size_t i, size_t) {
+        auto& chunk = chunks[i];
+        auto out = list.tokens.begin() + offsets[i];
+        auto copy = [&](const Token& token) {
+            *out = token;
+            if (token.symbol != SymbolTable::none)
+                out->symbol = chunk.global[token.symbol];
+            ++out;
+        };
+        for_each(chunk.relexed.begin(), chunk.relexed.end(), copy);
+        for_each(chunk.tokens.begin() + chunk.keep, chunk.tokens.end(), copy);
+    });
+    return list;
+}
@@ -0,0 +1,59 @@
+#include "source_map.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+
+string read_source_file(const string& file_name) {
+    if (file_name == "-")
+        return string(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+
+    // a directory opens and reports a size of LLONG_MAX, a pipe a size of -1
+    ifstream fin(file_name, ios::in | ios::binary | ios::ate);
+    auto size = fin.is_open() && !filesystem::is_directory(file_name) ? streamoff(fin.tellg()) : -1;
+    string source;
+    if (size >= 0) {
+        source.resize(size);
+        fin.seekg(0);
+    }
+    if (size < 0 || !fin.read(source.data(), source.size()))
+        throw runtime_error("read_source_file(): Cannot open file " + file_name);
+    return source;
+}
+
+
+SourceMap::SourceMap(const string_view& source) : source(source) {}
+
+
+void SourceMap::index() const {
+    if (!starts.empty())
+        return;
+    starts.push_back(0);
+    for (size_t i = source.find('\n'); i != string_view::npos; i = source.find('\n', i + 1))
+        starts.push_back(i + 1);
+}
+
+
+SourcePosition SourceMap::position(const uint32_t& offset) const {
+    if (offset > source.size())
+        return {};
+    index();
+    auto line = upper_bound(starts.begin(), starts.end(), offset) - starts.begin();
+    return {uint32_t(line), offset - starts[line - 1] + 1};
+}
+
+
+string_view SourceMap::line(const uint32_t& line) const {
+    index();
+    if (line == 0 || line > starts.size())
+        return {};
+    size_t begin = starts[line - 1];
+    size_t end = line < starts.size() ? starts[line] - 1 : source.size();
+    auto text = source.substr(begin, end - begin);
+    if (!text.empty() && text.back() == '\r')
+        text.remove_suffix(1);
+    return text;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+using namespace std;
+
+
+// 1-based line and column of a source offset; columns count bytes.
+struct SourcePosition {
+    uint32_t line = 0;
+    uint32_t column = 0;
+};
+
+
+// The text of a program file, standard input for "-". Throws a runtime_error
+// naming the file when it cannot be read, a directory included.
+string read_source_file(const string& file_name);
+
+
+// Maps the offsets that tokens and nodes carry back to lines and columns.
+// Tokens stay 16 bytes: the line starts are found once, on the first lookup,
+// and only by the tools that report positions. The buffer must outlive the map.
+class SourceMap {
+public:
+    SourceMap(const string_view&);
+
+    // {0, 0} for an offset past the end of the source, such as Node::no_offset.
+    SourcePosition position(const uint32_t&) const;
+    // The text of a 1-based line without its line break, empty when out of range.
+    string_view line(const uint32_t&) const;
+
+private:
+    string_view source;
+    mutable vector<uint32_t> starts; // offset of every line, filled on first use
+
+    void index() const;
+};
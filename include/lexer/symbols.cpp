@@ -0,0 +1,72 @@
+#include "symbols.hpp"
+#include <stdexcept>
+
+
+SymbolTable::SymbolTable() : slots(64, none) {
+    for (auto keyword : {"if", "elif", "else", "while", "main", "return", "continue", "break"})
+        intern(keyword);
+}
+
+
+uint32_t SymbolTable::hash(const string_view& text) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (auto c : text)
+        h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    return h;
+}
+
+
+size_t SymbolTable::probe(const string_view& text, const uint32_t& h) const {
+    size_t mask = slots.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        auto symbol = slots[i];
+        if (symbol == none || (hashes[symbol] == h && names[symbol] == text))
+            return i;
+    }
+}
+
+
+void SymbolTable::grow() {
+    vector<Symbol> old(slots.size() * 2, none);
+    swap(slots, old);
+    size_t mask = slots.size() - 1;
+    for (Symbol symbol = 0; symbol < names.size(); symbol++) {
+        size_t i = hashes[symbol] & mask;
+        while (slots[i] != none)
+            i = (i + 1) & mask;
+        slots[i] = symbol;
+    }
+}
+
+
+Symbol SymbolTable::intern(const string_view& text) {
+    auto h = hash(text);
+    auto slot = probe(text, h);
+    if (slots[slot] != none)
+        return slots[slot];
+
+    Symbol symbol = names.size();
+    names.emplace_back(text);
+    hashes.push_back(h);
+    slots[slot] = symbol;
+    if (names.size() * 2 > slots.size())
+        grow();
+    return symbol;
+}
+
+
+Symbol SymbolTable::find(const string_view& text) const {
+    return slots[probe(text, hash(text))];
+}
+
+
+const string& SymbolTable::name(const Symbol& symbol) const {
+    if (symbol >= names.size())
+        throw out_of_range("SymbolTable::name(): Unknown symbol " + to_string(symbol));
+    return names[symbol];
+}
+
+
+size_t SymbolTable::size() const {
+    return names.size();
+}
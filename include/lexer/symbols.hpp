@@ -0,0 +1,42 @@
+#pragma once
+
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+
+using namespace std;
+
+
+using Symbol = uint32_t;
+
+
+// Interned names: every distinct identifier is stored once and referred to by its index.
+class SymbolTable {
+public:
+    static constexpr Symbol none = UINT32_MAX;
+
+    // Keywords are interned on construction in this order, so their symbols are constants.
+    enum Keyword : Symbol { IF, ELIF, ELSE, WHILE, MAIN, RETURN, CONTINUE, BREAK };
+
+    SymbolTable();
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    Symbol intern(const string_view&);
+    Symbol find(const string_view&) const;
+    const string& name(const Symbol&) const;
+    size_t size() const;
+
+private:
+    deque<string> names;
+    vector<uint32_t> hashes; // per symbol, reused when the slot table grows
+    vector<Symbol> slots; // open addressing, linear probing, power of two size
+
+    static uint32_t hash(const string_view&);
+    size_t probe(const string_view&, const uint32_t&) const;
+    void grow();
+};
@@ -0,0 +1,97 @@
+#include "prepared.hpp"
+#include "lexer/source_map.hpp"
+#include "syntaxer/folder.hpp"
+#include "syntaxer/type_checker.hpp"
+#include "stats.hpp"
+#include "visitor.hpp"
+#include "vm/compiler.hpp"
+#include "vm/vm.hpp"
+#include <sstream>
+
+
+PreparedProgram::PreparedProgram(shared_ptr<const State> state) : state(move(state)) {}
+
+
+shared_ptr<PreparedProgram::State> PreparedProgram::build(string source, const bool& use_arena, const string& name) {
+    Stats stats; // only timed for the phase probes
+    auto state = make_shared<State>();
+    state->source = move(source);
+    {
+        Stats::Scope scope(stats, Stats::LEX);
+        state->tokens = Lexer::parse(state->source);
+    }
+    {
+        Stats::Scope scope(stats, Stats::PARSE);
+        state->ast = Syntaxer::parse(state->tokens, use_arena ? make_shared<Arena>() : nullptr);
+    }
+    {
+        Stats::Scope scope(stats, Stats::FOLD);
+        Folder::fold(*state->ast);
+    }
+    {
+        Stats::Scope scope(stats, Stats::CHECK);
+        TypeChecker::check(*state->ast);
+    }
+    Stats::Scope scope(stats, Stats::COMPILE);
+    state->program = Compiler::generate(*state->ast);
+    state->program.source_name = name;
+    return state;
+}
+
+
+PreparedProgram PreparedProgram::compile(string source, const bool& use_arena) {
+    return PreparedProgram(build(move(source), use_arena, ""));
+}
+
+
+PreparedProgram PreparedProgram::load(const string& file_name, const bool& use_arena) {
+    return PreparedProgram(build(read_source_file(file_name), use_arena, file_name));
+}
+
+
+PreparedProgram PreparedProgram::load(const string& file_name, const ProgramCache& cache) {
+    auto source = read_source_file(file_name);
+    if (auto program = cache.load(source)) {
+        auto state = make_shared<State>();
+        state->source = move(source); // offsets in the line tables point into it
+        state->program = move(*program);
+        state->program.source_name = file_name;
+        return PreparedProgram(move(state));
+    }
+    auto state = build(move(source), false, file_name);
+    cache.store(state->source, state->program); // best effort: a read-only cache only costs time
+    return PreparedProgram(move(state));
+}
+
+
+int PreparedProgram::run(ostream& out, istream& in) const {
+    VM vm(state->program, out, in);
+    return vm.run();
+}
+
+
+int PreparedProgram::run(Profiler& profiler, ostream& out, istream& in) const {
+    VM vm(state->program, out, in);
+    return vm.run(profiler);
+}
+
+
+string PreparedProgram::run(const string& input, int& result) const {
+    istringstream in(input);
+    ostringstream out;
+    result = run(out, in);
+    return move(out).str();
+}
+
+
+void PreparedProgram::print_ast(ostream& out) const {
+    if (!state->ast)
+        throw runtime_error("PreparedProgram::print_ast(): The program was loaded from the cache without its syntax tree");
+    Printer printer(out);
+    state->ast->accept(printer);
+}
+
+
+void PreparedProgram::print_bytecode(ostream& out) const {
+    state->program.disassemble(out);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+
+#include "lexer/lexer.hpp"
+#include "syntaxer/syntaxer.hpp"
+#include "vm/bytecode.hpp"
+#include "vm/cache.hpp"
+#include "vm/profiler.hpp"
+
+
+using namespace std;
+
+
+// A program lexed, parsed, checked and compiled once, to be run any number of
+// times. The handle is cheap to copy and everything it owns is immutable, so
+// copies may run on many threads at once: every run gets its own VM (stack,
+// globals, output buffer) and its own streams.
+class PreparedProgram {
+public:
+    // Throws the first lexer, syntax or type error, as Interpreter does.
+    static PreparedProgram compile(string source, const bool& use_arena = false);
+    // "-" reads the program from standard input
+    static PreparedProgram load(const string& file_name, const bool& use_arena = false);
+    // Takes the compiled program from the cache when it holds one for this source,
+    // else compiles it and stores the result. A cached program has no syntax tree.
+    static PreparedProgram load(const string& file_name, const ProgramCache&);
+
+    // Runs main and returns its result; print and printf write to `out`, read() takes numbers from `in`.
+    int run(ostream& out = cout, istream& in = cin) const;
+    // Runs main with `input` as its input and returns what it printed.
+    string run(const string& input, int& result) const;
+    // run() with the profiler sampling it.
+    int run(Profiler&, ostream& out = cout, istream& in = cin) const;
+
+    const Program& program() const { return state->program; }
+    string_view source() const { return state->source; }
+    void print_ast(ostream& = cout) const;
+    void print_bytecode(ostream& = cout) const;
+
+private:
+    struct State {
+        string source; // viewed by the tokens and the tree
+        TokenList tokens;
+        unique_ptr<AST> ast; // null when loaded from a ProgramCache
+        Program program;
+    };
+
+    shared_ptr<const State> state;
+
+    explicit PreparedProgram(shared_ptr<const State>);
+    static shared_ptr<State> build(string source, const bool& use_arena, const string& name);
+};
@@ -0,0 +1,12 @@
+#include "probes.hpp"
+
+
+#ifdef USDT_SUPPORTED
+// Tools find the semaphores through the .probes section and increment them
+// in the running process while they are attached.
+extern "C" {
+#define USDT_DEFINE(name) __attribute__((section(".probes"), used)) volatile unsigned short USDT_SEMAPHORE(name) = 0;
+USDT_PROBES(USDT_DEFINE)
+#undef USDT_DEFINE
+}
+#endif
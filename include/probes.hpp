@@ -0,0 +1,84 @@
+#pragma once
+
+
+#include <cstdint>
+
+
+// Static tracepoints in the SystemTap SDT format, which perf, bpftrace, bcc
+// and gdb read from the binary's .note.stapsdt section:
+//   perf probe -x ./main sdt_proglang:function_entry
+//   bpftrace -e 'usdt:./main:proglang:function_entry { @[str(arg1)] = count(); }'
+// A probe site is one nop. Each probe also has a semaphore that attaching
+// tools increment, so arguments that cost something to compute are guarded:
+//   if (USDT_ENABLED(function_entry))
+//       USDT_PROBE3(function_entry, index, name, depth);
+// Arguments are passed as 64-bit integers; strings as pointers. The format
+// is implemented here rather than taken from <sys/sdt.h>, so building needs
+// no extra package. Linux on x86-64 only; elsewhere the macros do nothing.
+//
+//   phase_start(name)                 a Stats phase begins: "lex", "parse", ..., "run"
+//   phase_end(name, nanoseconds)      and ends
+//   function_entry(index, name, depth)   the VM enters Program::functions[index]
+//   function_return(index, name, depth)  and returns from it; depth 0 is <init> or main
+//   print(bytes)                      print() wrote one value or string
+//   printf(format, bytes)             printf() formatted `bytes` bytes
+//   read(ok)                          read() parsed a number (1) or failed (0)
+#define USDT_PROBES(X) \
+    X(phase_start) X(phase_end) X(function_entry) X(function_return) X(print) X(printf) X(read)
+
+
+#if defined(__linux__) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define USDT_SUPPORTED
+
+#define USDT_SEMAPHORE(name) proglang_##name##_semaphore
+#define USDT_DECLARE(name) extern "C" volatile unsigned short USDT_SEMAPHORE(name);
+USDT_PROBES(USDT_DECLARE)
+#undef USDT_DECLARE
+
+#define USDT_ENABLED(name) __builtin_expect(USDT_SEMAPHORE(name) != 0, 0)
+
+// The note records the address of the nop, the link-time base that tools
+// relocate it by, the semaphore, the provider, the probe name and where each
+// argument is ("8@%rdi", "8@$5", "8@16(%rsp)").
+#define USDT_ASM(name, arguments) \
+    "990: nop\n" \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+    ".balign 4\n" \
+    ".4byte 992f-991f, 994f-993f, 3\n" \
+    "991: .asciz \"stapsdt\"\n" \
+    "992: .balign 4\n" \
+    "993: .8byte 990b\n" \
+    ".8byte _.stapsdt.base\n" \
+    ".8byte proglang_" #name "_semaphore\n" \
+    ".asciz \"proglang\"\n" \
+    ".asciz \"" #name "\"\n" \
+    ".asciz \"" arguments "\"\n" \
+    "994: .balign 4\n" \
+    ".popsection\n" \
+    ".ifndef _.stapsdt.base\n" \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+    ".weak _.stapsdt.base\n" \
+    ".hidden _.stapsdt.base\n" \
+    "_.stapsdt.base: .space 1\n" \
+    ".size _.stapsdt.base, 1\n" \
+    ".popsection\n" \
+    ".endif\n"
+
+#define USDT_ARG(value) "nor"((uint64_t)(value))
+
+#define USDT_PROBE1(name, a) \
+    __asm__ __volatile__(USDT_ASM(name, "8@%[a1]") :: [a1] USDT_ARG(a))
+#define USDT_PROBE2(name, a, b) \
+    __asm__ __volatile__(USDT_ASM(name, "8@%[a1] 8@%[a2]") :: [a1] USDT_ARG(a), [a2] USDT_ARG(b))
+#define USDT_PROBE3(name, a, b, c) \
+    __asm__ __volatile__(USDT_ASM(name, "8@%[a1] 8@%[a2] 8@%[a3]") \
+                         :: [a1] USDT_ARG(a), [a2] USDT_ARG(b), [a3] USDT_ARG(c))
+
+#else
+
+#define USDT_ENABLED(name) false
+#define USDT_PROBE1(name, a) do {} while (0)
+#define USDT_PROBE2(name, a, b) do {} while (0)
+#define USDT_PROBE3(name, a, b, c) do {} while (0)
+
+#endif
@@ -0,0 +1,112 @@
+#include "stats.hpp"
+#include "probes.hpp"
+#include <iomanip>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+
+atomic<uint64_t> AllocationCounter::allocations{0}, AllocationCounter::bytes{0};
+bool AllocationCounter::enabled = false;
+
+
+long peak_rss_kib() {
+#if defined(__APPLE__)
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#elif defined(__unix__)
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#else
+    return 0;
+#endif
+}
+
+
+Stats::Scope::Scope(Stats& stats, const Phase& phase)
+    : phase(stats.phases[phase]),
+      phase_name(name(phase)),
+      start(chrono::steady_clock::now()),
+      allocations(AllocationCounter::allocations.load(memory_order_relaxed)),
+      bytes(AllocationCounter::bytes.load(memory_order_relaxed)) {
+    USDT_PROBE1(phase_start, phase_name);
+}
+
+
+Stats::Scope::~Scope() {
+    auto elapsed = chrono::steady_clock::now() - start;
+    USDT_PROBE2(phase_end, phase_name, chrono::duration_cast<chrono::nanoseconds>(elapsed).count());
+    phase.seconds += chrono::duration<double>(elapsed).count();
+    phase.allocations += AllocationCounter::allocations.load(memory_order_relaxed) - allocations;
+    phase.allocated_bytes += AllocationCounter::bytes.load(memory_order_relaxed) - bytes;
+}
+
+
+const char* Stats::name(const Phase& phase) {
+    static const char* names[] = {"read", "lex", "parse", "fold", "check", "compile", "run", "print"};
+    return phase < PHASE_COUNT ? names[phase] : "?";
+}
+
+
+const char* Stats::name(const Node::NodeType& type) {
+    static const char* names[] = {"string", "vardecl", "funcdecl", "block", "expression",
+                                  "conditional", "loop", "return", "jump"};
+    return type <= Node::JUMP ? names[type] : "?";
+}
+
+
+double Stats::total_seconds() const {
+    double total = 0;
+    for (const auto& it : phases)
+        total += it.seconds;
+    return total;
+}
+
+
+void Stats::write(ostream& out) const {
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << fixed << setprecision(3);
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const auto& phase = phases[i];
+        if (!phase.seconds && !phase.allocations)
+            continue;
+        out << setw(8) << left << name(Phase(i)) << right << setw(10) << phase.seconds * 1e3 << " ms";
+        if (counts_allocations)
+            out << setw(10) << phase.allocations << " allocations" << setw(12) << phase.allocated_bytes / 1024.0 << " KiB";
+        out << "\n";
+    }
+    out << setw(8) << left << "total" << right << setw(10) << total_seconds() * 1e3 << " ms\n";
+    out << "source: " << bytes_read << " bytes, " << tokens << " tokens, " << symbols << " symbols\n";
+    out << "nodes:";
+    for (int i = 0; i <= Node::JUMP; i++)
+        if (nodes[i])
+            out << " " << name(Node::NodeType(i)) << " " << nodes[i];
+    out << "\nbytecode: " << functions << " functions, " << instructions << " instructions\n";
+    out << "peak RSS: " << peak_rss_kib << " KiB" << endl;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+
+void Stats::write_json(ostream& out) const {
+    auto precision = out.precision();
+    out << setprecision(9) << "{\"phases\": {";
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const auto& phase = phases[i];
+        out << (i ? ", " : "") << "\"" << name(Phase(i)) << "\": {\"seconds\": " << phase.seconds;
+        if (counts_allocations)
+            out << ", \"allocations\": " << phase.allocations << ", \"allocated_bytes\": " << phase.allocated_bytes;
+        out << "}";
+    }
+    out << "}, \"total_seconds\": " << total_seconds() << ", \"bytes_read\": " << bytes_read << ", \"tokens\": " << tokens
+        << ", \"symbols\": " << symbols << ", \"nodes\": {";
+    for (int i = 0; i <= Node::JUMP; i++)
+        out << (i ? ", " : "") << "\"" << name(Node::NodeType(i)) << "\": " << nodes[i];
+    out << "}, \"functions\": " << functions << ", \"instructions\": " << instructions
+        << ", \"peak_rss_kib\": " << peak_rss_kib << "}" << endl;
+    out.precision(precision);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include "syntaxer/tree.hpp"
+
+
+using namespace std;
+
+
+// Heap use of the whole process. The counters only move in executables that
+// link the allocation_counter object library, which replaces operator new
+// (main and the benches that count allocations do); elsewhere enabled stays
+// false and they read 0.
+struct AllocationCounter {
+    static atomic<uint64_t> allocations, bytes;
+    static bool enabled;
+};
+
+
+// Wall time and heap use of one phase; repeated phases add up.
+struct PhaseStats {
+    double seconds = 0;
+    uint64_t allocations = 0, allocated_bytes = 0;
+};
+
+
+// Where an Interpreter spent its time and memory, phase by phase.
+class Stats {
+public:
+    // READ: source into memory; LEX: tokens; PARSE: syntax tree (lexing
+    // included for parse_stream); FOLD: constant folding; CHECK: resolving and
+    // type checking; COMPILE: bytecode; RUN: the VM; PRINT: print_ast and print_bytecode.
+    enum Phase { READ, LEX, PARSE, FOLD, CHECK, COMPILE, RUN, PRINT, PHASE_COUNT };
+
+    PhaseStats phases[PHASE_COUNT];
+    uint64_t bytes_read = 0, tokens = 0, symbols = 0;
+    uint64_t nodes[Node::JUMP + 1] = {}; // by NodeType, of the tree as it is now
+    uint64_t functions = 0, instructions = 0; // compiled bytecode
+    long peak_rss_kib = 0;
+    bool counts_allocations = false;
+
+    static const char* name(const Phase&);
+    static const char* name(const Node::NodeType&);
+    double total_seconds() const;
+
+    void write(ostream&) const;
+    void write_json(ostream&) const;
+
+    // Adds the time and allocations from construction to destruction to a
+    // phase, and fires the phase_start and phase_end probes (probes.hpp).
+    class Scope {
+    public:
+        Scope(Stats&, const Phase&);
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope();
+
+    private:
+        PhaseStats& phase;
+        const char* phase_name;
+        chrono::steady_clock::time_point start;
+        uint64_t allocations, bytes;
+    };
+};
+
+
+// Peak resident set size of the process in KiB, 0 where unknown.
+long peak_rss_kib();
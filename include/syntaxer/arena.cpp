@@ -0,0 +1,38 @@
+#include "arena.hpp"
+#include <cstdint>
+
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    auto aligned = reinterpret_cast<byte*>((reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(alignment - 1));
+    if (!cursor || aligned + bytes > end) {
+        auto size = max(next_chunk, bytes + alignment);
+        chunks.push_back(make_unique_for_overwrite<byte[]>(size));
+        cursor = chunks.back().get();
+        end = cursor + size;
+        reserved_bytes += size;
+        next_chunk = min(next_chunk * 2, max_chunk);
+        aligned = reinterpret_cast<byte*>((reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(alignment - 1));
+    }
+
+    cursor = aligned + bytes;
+    allocated_bytes += bytes;
+    return aligned;
+}
+
+
+void Arena::do_deallocate(void*, size_t, size_t) {}
+
+
+bool Arena::do_is_equal(const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+
+size_t Arena::allocated() const {
+    return allocated_bytes;
+}
+
+
+size_t Arena::reserved() const {
+    return reserved_bytes;
+}
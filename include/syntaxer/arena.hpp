@@ -0,0 +1,38 @@
+#pragma once
+
+
+#include <memory_resource>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+
+using namespace std;
+
+
+// Bump allocator for AST nodes and their child lists. Deallocation is a no-op;
+// all memory is returned at once when the arena is destroyed, without running
+// node destructors.
+class Arena : public pmr::memory_resource {
+public:
+    static const size_t initial_chunk = 64 * 1024;
+    static const size_t max_chunk = 4 * 1024 * 1024;
+
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    size_t allocated() const;
+    size_t reserved() const;
+
+private:
+    vector<unique_ptr<byte[]>> chunks;
+    byte* cursor = nullptr;
+    byte* end = nullptr;
+    size_t next_chunk = initial_chunk;
+    size_t allocated_bytes = 0, reserved_bytes = 0;
+
+    virtual void* do_allocate(size_t, size_t) override;
+    virtual void do_deallocate(void*, size_t, size_t) override;
+    virtual bool do_is_equal(const pmr::memory_resource&) const noexcept override;
+};
@@ -0,0 +1,516 @@
+#include "tree.hpp"
+#include <cfloat>
+#include <cstring>
+
+
+// Block-at-a-time evaluation for Expr::eval_batch(). The tree is walked once
+// per block of inputs, and every node runs as a loop over the whole block, so
+// the per-node dispatch is paid once per `block` points instead of per point.
+// With GCC/Clang the loops use vector extensions: AVX2+FMA when the CPU has
+// them, 128-bit SSE2 lanes otherwise; other compilers get plain scalar loops.
+namespace {
+
+
+const size_t block = 256;
+const size_t max_lanes = 4; // blocks are padded to a multiple of this
+
+
+double unary_scalar(const Expr::Operator& op, const double& a) {
+    switch (op) {
+        case Expr::ADD: return a;
+        case Expr::SUB: return -a;
+        case Expr::NOT: return a == 0;
+        case Expr::SIN: return sin(a);
+        case Expr::COS: return cos(a);
+        case Expr::EXP: return exp(a);
+        case Expr::LOG: return log(a);
+        case Expr::ABS: return fabs(a);
+        case Expr::SGN: return (a > 0) - (a < 0);
+        default: return NAN;
+    }
+}
+
+
+double binary_scalar(const Expr::Operator& op, const double& a, const double& b) {
+    switch (op) {
+        case Expr::ADD: return a + b;
+        case Expr::SUB: return a - b;
+        case Expr::MUL: return a * b;
+        case Expr::DIV: return a / b;
+        case Expr::MOD: return fmod(a, b);
+        case Expr::POW: return pow(a, b);
+        case Expr::EQ: return a == b;
+        case Expr::NE: return a != b;
+        case Expr::LT: return a < b;
+        case Expr::LE: return a <= b;
+        case Expr::GT: return a > b;
+        case Expr::GE: return a >= b;
+        case Expr::AND: return a != 0 && b != 0;
+        case Expr::OR: return a != 0 || b != 0;
+        default: return NAN;
+    }
+}
+
+
+void unary_loop(Expr::Operator op, const double* a, double* out, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        out[i] = unary_scalar(op, a[i]);
+}
+
+
+void binary_loop(Expr::Operator op, const double* a, const double* b, double* out, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        out[i] = binary_scalar(op, a[i], b[i]);
+}
+
+
+struct Kernels {
+    void (*unary)(Expr::Operator, const double*, double*, size_t);
+    void (*binary)(Expr::Operator, const double*, const double*, double*, size_t);
+};
+
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BATCH_SIMD
+#define SIMD_INLINE inline __attribute__((always_inline))
+#if !defined(__clang__)
+// 256-bit values only cross function boundaries inside always_inline helpers
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+typedef double v2df __attribute__((vector_size(16)));
+typedef int64_t v2di __attribute__((vector_size(16)));
+typedef uint64_t v2du __attribute__((vector_size(16)));
+typedef double v4df __attribute__((vector_size(32)));
+typedef int64_t v4di __attribute__((vector_size(32)));
+typedef uint64_t v4du __attribute__((vector_size(32)));
+
+template <class D> struct Lanes;
+template <> struct Lanes<v2df> { using I = v2di; using U = v2du; static const size_t size = 2; };
+template <> struct Lanes<v4df> { using I = v4di; using U = v4du; static const size_t size = 4; };
+
+
+template <class D> SIMD_INLINE D load(const double* p) {
+    D v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template <class D> SIMD_INLINE void store(double* p, const D& v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+template <class D> SIMD_INLINE D splat(const double& c) {
+    return D{} + c;
+}
+
+template <class D> SIMD_INLINE typename Lanes<D>::I sign_bit() {
+    return typename Lanes<D>::I{} + INT64_MIN;
+}
+
+// Comparisons yield all-ones/all-zeros lanes of the matching integer vector.
+template <class D, class I> SIMD_INLINE D select(const I& mask, const D& a, const D& b) {
+    return (D)((mask & (I)a) | (~mask & (I)b));
+}
+
+template <class D, class I> SIMD_INLINE D truth(const I& mask) {
+    return (D)(mask & (I)splat<D>(1.0));
+}
+
+// Exact for |x| < 2^51; adding and removing 1.5 * 2^52 rounds to nearest even.
+template <class D> SIMD_INLINE D round_v(const D& x) {
+    const double magic = 0x1.8p52;
+    return (x + magic) - magic;
+}
+
+template <class D> SIMD_INLINE D floor_v(const D& x) {
+    D r = round_v(x);
+    return r - truth<D>(r > x);
+}
+
+// Integral double (|k| < 2^51) to int64 lanes, through the same magic constant.
+template <class D> SIMD_INLINE typename Lanes<D>::I to_int(const D& k) {
+    using I = typename Lanes<D>::I;
+    return (I)(k + 0x1.8p52) - (I)splat<D>(0x1.8p52);
+}
+
+// 2^k for integral k in [-1022, 1023]
+template <class D> SIMD_INLINE D exp2_int(const D& k) {
+    using I = typename Lanes<D>::I;
+    return (D)((to_int(k) + I{} + 1023) << 52);
+}
+
+
+// Range reduction to r = x - n ln2 with |r| <= ln2 / 2, a degree-13 Taylor
+// polynomial, and 2^n applied in two halves so subnormal results round once.
+template <class D> SIMD_INLINE D exp_v(const D& x) {
+    D clamped = select(x < -746.0, splat<D>(-746.0), select(x > 710.0, splat<D>(710.0), x));
+    D n = round_v(clamped * 1.4426950408889634074);
+    D r = (clamped - n * 6.93145751953125e-1) - n * 1.42860682030941723212e-6;
+
+    D p = splat<D>(1.0 / 6227020800.0);
+    p = p * r + 1.0 / 479001600.0;
+    p = p * r + 1.0 / 39916800.0;
+    p = p * r + 1.0 / 3628800.0;
+    p = p * r + 1.0 / 362880.0;
+    p = p * r + 1.0 / 40320.0;
+    p = p * r + 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+
+    D half = floor_v(n * 0.5);
+    D result = p * exp2_int(half) * exp2_int(n - half);
+    return select(x != x, x, result);
+}
+
+
+// fdlibm's e_log.c: x = 2^e * m with m in [sqrt(2)/2, sqrt(2)), and
+// log(m) = f - f^2/2 + s (f^2/2 + R(s^2)) where f = m - 1, s = f / (2 + f).
+template <class D> SIMD_INLINE D log_v(const D& x) {
+    using U = typename Lanes<D>::U;
+    auto tiny = x < DBL_MIN; // subnormals are scaled into the normal range
+    D scaled = select(tiny, x * 0x1p54, x);
+    U bits = (U)scaled;
+
+    D e = (D)((bits >> 52) | (U)splat<D>(0x1p52)) - 0x1p52 - 1023.0 - select(tiny, splat<D>(54.0), D{});
+    D m = (D)((bits & 0x000fffffffffffffull) | 0x3ff0000000000000ull);
+    auto big = m > 1.41421356237309504880;
+    m = select(big, m * 0.5, m);
+    e = e + truth<D>(big);
+
+    D f = m - 1.0;
+    D hfsq = 0.5 * f * f;
+    D s = f / (2.0 + f);
+    D z = s * s;
+    D w = z * z;
+    D t1 = w * (3.999999999940941908e-01 + w * (2.222219843214978396e-01 + w * 1.531383769920937332e-01));
+    D t2 = z * (6.666666666666735130e-01 + w * (2.857142874366239149e-01 + w * (1.818357216161805012e-01 + w * 1.479819860511658591e-01)));
+    D result = e * 6.93147180369123816490e-01 - ((hfsq - (s * (hfsq + t1 + t2) + e * 1.90821492927058770002e-10)) - f);
+
+    result = select(x == 0.0, splat<D>(-INFINITY), result);
+    result = select(x < 0.0, splat<D>(NAN), result);
+    result = select(x == INFINITY, x, result);
+    return select(x != x, x, result);
+}
+
+
+// Cephes' sin.c: reduce |x| by multiples of pi/4 in three parts and pick the
+// sine or cosine polynomial by octant. Accurate while |x| stays below
+// sincos_limit; larger inputs are redone with libm.
+const double sincos_limit = 0x1p24;
+
+template <class D> SIMD_INLINE void sincos_octant(const D& ax, D& sine, D& cosine, typename Lanes<D>::I& j) {
+    using I = typename Lanes<D>::I;
+    D y = floor_v(ax * 1.27323954473516268615);
+    j = to_int(y);
+    I odd = j & 1;
+    j = (j + odd) & 7;
+    y = y + truth<D>(odd != 0);
+
+    D z = ((ax - y * 7.85398125648498535156e-1) - y * 3.77489470793079817668e-8) - y * 2.69515142907905952645e-15;
+    D zz = z * z;
+    D ps = splat<D>(1.58962301576546568060e-10);
+    ps = ps * zz - 2.50507477628578072866e-8;
+    ps = ps * zz + 2.75573136213857245213e-6;
+    ps = ps * zz - 1.98412698295895385996e-4;
+    ps = ps * zz + 8.33333333332211858878e-3;
+    ps = ps * zz - 1.66666666666666307295e-1;
+    D pc = splat<D>(-1.13585365213876817300e-11);
+    pc = pc * zz + 2.08757008419747316778e-9;
+    pc = pc * zz - 2.75573141792967388112e-7;
+    pc = pc * zz + 2.48015872888517045348e-5;
+    pc = pc * zz - 1.38888888888730564116e-3;
+    pc = pc * zz + 4.16666666666665929218e-2;
+    sine = z + z * zz * ps;
+    cosine = 1.0 - 0.5 * zz + zz * zz * pc;
+}
+
+template <class D> SIMD_INLINE D flip_sign(const D& v, const typename Lanes<D>::I& mask) {
+    using I = typename Lanes<D>::I;
+    return (D)((I)v ^ (mask & sign_bit<D>()));
+}
+
+template <class D> SIMD_INLINE D sin_v(const D& x) {
+    using I = typename Lanes<D>::I;
+    D ax = (D)((I)x & ~sign_bit<D>());
+    D sine, cosine;
+    I j;
+    sincos_octant(ax, sine, cosine, j);
+    I negative = ((I)x >> 63) ^ (j > 3); // sign bit, so sin(-0) stays -0
+    j = j & 3;
+    return flip_sign(select((j == 1) | (j == 2), cosine, sine), negative);
+}
+
+template <class D> SIMD_INLINE D cos_v(const D& x) {
+    using I = typename Lanes<D>::I;
+    D ax = (D)((I)x & ~sign_bit<D>());
+    D sine, cosine;
+    I j;
+    sincos_octant(ax, sine, cosine, j);
+    I negative = (j > 3) ^ ((j & 3) > 1);
+    j = j & 3;
+    return flip_sign(select((j == 1) | (j == 2), sine, cosine), negative);
+}
+
+
+template <class D, class F> SIMD_INLINE void map(const double* a, double* out, const size_t& n, F f) {
+    for (size_t i = 0; i < n; i += Lanes<D>::size)
+        store(out + i, f(load<D>(a + i)));
+}
+
+template <class D, class F> SIMD_INLINE void map(const double* a, const double* b, double* out, const size_t& n, F f) {
+    for (size_t i = 0; i < n; i += Lanes<D>::size)
+        store(out + i, f(load<D>(a + i), load<D>(b + i)));
+}
+
+// As map(), with the lanes `outside` accepts recomputed by the scalar `exact`.
+// Lanes are patched before the store since `out` may alias the inputs.
+template <class D, class F, class P, class S>
+SIMD_INLINE void map(const double* a, double* out, const size_t& n, F f, P outside, S exact) {
+    for (size_t i = 0; i < n; i += Lanes<D>::size) {
+        D x = load<D>(a + i), r = f(x);
+        for (size_t lane = 0; lane < Lanes<D>::size; lane++)
+            if (outside(x[lane]))
+                r[lane] = exact(x[lane]);
+        store(out + i, r);
+    }
+}
+
+template <class D, class F, class P, class S>
+SIMD_INLINE void map(const double* a, const double* b, double* out, const size_t& n, F f, P outside, S exact) {
+    for (size_t i = 0; i < n; i += Lanes<D>::size) {
+        D x = load<D>(a + i), y = load<D>(b + i), r = f(x, y);
+        for (size_t lane = 0; lane < Lanes<D>::size; lane++)
+            if (outside(x[lane], y[lane]))
+                r[lane] = exact(x[lane], y[lane]);
+        store(out + i, r);
+    }
+}
+
+
+template <class D> SIMD_INLINE void unary_kernel(Expr::Operator op, const double* a, double* out, size_t n) {
+    using I = typename Lanes<D>::I;
+    switch (op) {
+        case Expr::ADD:
+            memmove(out, a, n * sizeof(double));
+            return;
+        case Expr::SUB:
+            map<D>(a, out, n, [](const D& x) __attribute__((always_inline)) { return -x; });
+            return;
+        case Expr::NOT:
+            map<D>(a, out, n, [](const D& x) __attribute__((always_inline)) { return truth<D>(x == 0.0); });
+            return;
+        case Expr::ABS:
+            map<D>(a, out, n, [](const D& x) __attribute__((always_inline)) { return (D)((I)x & ~sign_bit<D>()); });
+            return;
+        case Expr::SGN:
+            map<D>(a, out, n, [](const D& x) __attribute__((always_inline)) { return truth<D>(x > 0.0) - truth<D>(x < 0.0); });
+            return;
+        case Expr::EXP:
+            map<D>(a, out, n, [](const D& x) __attribute__((always_inline)) { return exp_v(x); });
+            return;
+        case Expr::LOG:
+            map<D>(a, out, n, [](const D& x) __attribute__((always_inline)) { return log_v(x); });
+            return;
+        case Expr::SIN:
+            map<D>(a, out, n, [](const D& x) __attribute__((always_inline)) { return sin_v(x); },
+                   [](double x) { return !(fabs(x) < sincos_limit) && x == x; }, [](double x) { return sin(x); });
+            return;
+        case Expr::COS:
+            map<D>(a, out, n, [](const D& x) __attribute__((always_inline)) { return cos_v(x); },
+                   [](double x) { return !(fabs(x) < sincos_limit) && x == x; }, [](double x) { return cos(x); });
+            return;
+        default:
+            unary_loop(op, a, out, n);
+    }
+}
+
+
+template <class D> SIMD_INLINE void binary_kernel(Expr::Operator op, const double* a, const double* b, double* out, size_t n) {
+    switch (op) {
+        case Expr::ADD: map<D>(a, b, out, n, [](const D& x, const D& y) __attribute__((always_inline)) { return x + y; }); return;
+        case Expr::SUB: map<D>(a, b, out, n, [](const D& x, const D& y) __attribute__((always_inline)) { return x - y; }); return;
+        case Expr::MUL: map<D>(a, b, out, n, [](const D& x, const D& y) __attribute__((always_inline)) { return x * y; }); return;
+        case Expr::DIV: map<D>(a, b, out, n, [](const D& x, const D& y) __attribute__((always_inline)) { return x / y; }); return;
+        case Expr::EQ: map<D>(a, b, out, n, [](const D& x, const D& y) __attribute__((always_inline)) { return truth<D>(x == y); }); return;
+        case Expr::NE: map<D>(a, b, out, n, [](const D& x, const D& y) __attribute__((always_inline)) { return truth<D>(x != y); }); return;
+        case Expr::LT: map<D>(a, b, out, n, [](const D& x, const D& y) __attribute__((always_inline)) { return truth<D>(x < y); }); return;
+        case Expr::LE: map<D>(a, b, out, n, [](const D& x, const D& y) __attribute__((always_inline)) { return truth<D>(x <= y); }); return;
+        case Expr::GT: map<D>(a, b, out, n, [](const D& x, const D& y) __attribute__((always_inline)) { return truth<D>(x > y); }); return;
+        case Expr::GE: map<D>(a, b, out, n, [](const D& x, const D& y) __attribute__((always_inline)) { return truth<D>(x >= y); }); return;
+        case Expr::AND:
+            map<D>(a, b, out, n, [](const D& x, const D& y) __attribute__((always_inline)) { return truth<D>((x != 0.0) & (y != 0.0)); });
+            return;
+        case Expr::OR:
+            map<D>(a, b, out, n, [](const D& x, const D& y) __attribute__((always_inline)) { return truth<D>((x != 0.0) | (y != 0.0)); });
+            return;
+        case Expr::POW:
+            // exp(y log x) covers positive finite bases; the error grows with |y log x|.
+            // Negative and zero bases, infinities and NaNs keep libm's special cases.
+            map<D>(a, b, out, n, [](const D& x, const D& y) __attribute__((always_inline)) { return exp_v(y * log_v(x)); },
+                   [](double x, double y) { return !(x > 0 && x <= DBL_MAX && fabs(y) <= DBL_MAX); },
+                   [](double x, double y) { return pow(x, y); });
+            return;
+        default:
+            binary_loop(op, a, b, out, n);
+    }
+}
+
+
+void unary_sse2(Expr::Operator op, const double* a, double* out, size_t n) {
+    unary_kernel<v2df>(op, a, out, n);
+}
+
+void binary_sse2(Expr::Operator op, const double* a, const double* b, double* out, size_t n) {
+    binary_kernel<v2df>(op, a, b, out, n);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BATCH_AVX2
+
+__attribute__((target("avx2,fma"))) void unary_avx2(Expr::Operator op, const double* a, double* out, size_t n) {
+    unary_kernel<v4df>(op, a, out, n);
+}
+
+__attribute__((target("avx2,fma"))) void binary_avx2(Expr::Operator op, const double* a, const double* b, double* out, size_t n) {
+    binary_kernel<v4df>(op, a, b, out, n);
+}
+#endif
+#endif
+
+
+const Kernels& kernels() {
+    static const Kernels selected = [] {
+#if defined(BATCH_AVX2)
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return Kernels{unary_avx2, binary_avx2};
+#endif
+#if defined(BATCH_SIMD)
+        return Kernels{unary_sse2, binary_sse2};
+#else
+        return Kernels{unary_loop, binary_loop};
+#endif
+    }();
+    return selected;
+}
+
+
+// One scratch block per tree level: a node evaluates into the buffer it is
+// given, and a binary node's right operand goes one level down.
+class BatchEval {
+public:
+    const Kernels& k = kernels();
+    vector<vector<double>> buffers;
+    size_t valid = 0; // inputs of the current block that are not padding
+
+    double* buffer(const size_t& level) {
+        if (buffers.size() <= level)
+            buffers.resize(level + 1, vector<double>(block));
+        return buffers[level].data();
+    }
+
+    void run(const Expr& expr, const double* xs, double* out, const size_t& n, const size_t& level) {
+        switch (expr.type) {
+            case Expr::CONST:
+                fill_n(out, n, expr.number);
+                return;
+            case Expr::CHAR:
+                fill_n(out, n, expr.value.empty() ? 0.0 : double(expr.value[0]));
+                return;
+            case Expr::VAR:
+                memcpy(out, xs, n * sizeof(double));
+                return;
+            case Expr::PRE_UNARY_OP:
+                if (expr.op != Expr::ADD && expr.op != Expr::SUB && expr.op != Expr::NOT)
+                    break;
+                k.unary(expr.op, operand(*expr.branches[0], xs, out, n, level), out, n);
+                return;
+            case Expr::BINARY_OP:
+                if (expr.op < Expr::ADD || expr.op > Expr::OR || expr.op == Expr::NOT)
+                    break;
+                if ((expr.op == Expr::DIV || expr.op == Expr::MOD) && is_integral_type(expr.value_type)) {
+                    integer_division(expr, xs, out, n, level);
+                    return;
+                }
+                binary(expr, xs, out, n, level);
+                return;
+            case Expr::CAST: {
+                auto a = operand(*expr.branches[0], xs, out, n, level);
+                for (size_t i = 0; i < n; i++)
+                    out[i] = Expr::convert(a[i], expr.value_type);
+                return;
+            }
+            case Expr::MATH_FUNC:
+            case Expr::BUILTIN_FUNC:
+                if (expr.branches.size() != (expr.op == Expr::POW ? 2u : 1u))
+                    break;
+                if (expr.op == Expr::POW) {
+                    binary(expr, xs, out, n, level);
+                    return;
+                }
+                if (expr.op != Expr::SIN && expr.op != Expr::COS && expr.op != Expr::EXP && expr.op != Expr::LOG &&
+                    expr.op != Expr::ABS && expr.op != Expr::SGN)
+                    break;
+                k.unary(expr.op, operand(*expr.branches[0], xs, out, n, level), out, n);
+                return;
+            default:
+                break;
+        }
+        throw runtime_error("Expr::eval_batch(): Cannot evaluate " + string(expr.value));
+    }
+
+    // Where the operand's values end up: x is read straight from the input.
+    const double* operand(const Expr& expr, const double* xs, double* out, const size_t& n, const size_t& level) {
+        if (expr.type == Expr::VAR)
+            return xs;
+        run(expr, xs, out, n, level);
+        return out;
+    }
+
+    void binary(const Expr& expr, const double* xs, double* out, const size_t& n, const size_t& level) {
+        auto left = operand(*expr.branches[0], xs, out, n, level);
+        auto right = operand(*expr.branches[1], xs, buffer(level + 1), n, level + 1);
+        k.binary(expr.op, left, right, out, n);
+    }
+
+    void integer_division(const Expr& expr, const double* xs, double* out, const size_t& n, const size_t& level) {
+        auto left = operand(*expr.branches[0], xs, out, n, level);
+        auto right = operand(*expr.branches[1], xs, buffer(level + 1), n, level + 1);
+        for (size_t i = 0; i < n; i++) {
+            if (right[i] == 0 && i < valid)
+                throw runtime_error("Expr::eval_batch(): Integer division by zero");
+            out[i] = expr.op == Expr::DIV ? trunc(left[i] / right[i]) : fmod(left[i], right[i]);
+        }
+    }
+};
+
+
+}
+
+
+void Expr::eval_batch(span<const double> xs, span<double> out) const {
+    if (out.size() < xs.size())
+        throw runtime_error("Expr::eval_batch(): Output is shorter than the input");
+
+    BatchEval batch;
+    double* padded_out = batch.buffer(0);
+    vector<double> padded_in(block, 0.0);
+    for (size_t start = 0; start < xs.size(); start += block) {
+        size_t n = min(block, xs.size() - start);
+        batch.valid = n;
+        if (n == block) {
+            batch.run(*this, xs.data() + start, out.data() + start, n, 0);
+            continue;
+        }
+        // the tail is padded to whole vectors and copied out
+        size_t rounded = (n + max_lanes - 1) / max_lanes * max_lanes;
+        copy_n(xs.data() + start, n, padded_in.data());
+        batch.run(*this, padded_in.data(), padded_out, rounded, 0);
+        copy_n(padded_out, n, out.data() + start);
+    }
+}
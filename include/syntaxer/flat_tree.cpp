@@ -0,0 +1,169 @@
+#include "flat_tree.hpp"
+#include "../visitor.hpp"
+
+
+class FlatAST::Builder : public ConstVisitor {
+public:
+	FlatAST& flat;
+	Index last = none;
+
+	Builder(FlatAST& flat) : flat(flat) {}
+
+	Index add(const Node::NodeType& kind, const uint8_t& subkind, const uint32_t& payload, const string_view& text, const size_t& children) {
+		Index node = flat.kinds.size();
+		flat.kinds.push_back(kind);
+		flat.subkinds.push_back(subkind);
+		flat.payloads.push_back(payload);
+		if (text.empty())
+			flat.texts.push_back(none);
+		else {
+			flat.texts.push_back(flat.strings.size());
+			flat.strings.push_back(text);
+		}
+		flat.first.push_back(flat.children.size());
+		flat.count.push_back(children);
+		flat.children.resize(flat.children.size() + children, none);
+		return node;
+	}
+
+	template<class T>
+	void link(const Index& parent, const uint32_t& i, T* child) {
+		child->accept(*this);
+		flat.children[flat.first[parent] + i] = last;
+	}
+
+	virtual void visit(const AST& root) override {
+		for (auto& it : root.declarations) {
+			it->accept(*this);
+			flat.roots.push_back(last);
+		}
+	}
+
+	virtual void visit(const VarDeclaration& var) override {
+		auto node = add(Node::VARDECL, 0, var.var_name, var.datatype, var.value ? 1 : 0);
+		if (var.value)
+			link(node, 0, var.value.get());
+		last = node;
+	}
+
+	virtual void visit(const FuncProt& prot) override {
+		auto node = add(Node::FUNCDECL, FuncDeclaration::PROT, prot.func_name, prot.return_type, prot.args.size());
+		for (size_t i = 0; i < prot.args.size(); i++)
+			link(node, i, prot.args[i].get());
+		last = node;
+	}
+
+	virtual void visit(const FuncDef& def) override {
+		auto node = add(Node::FUNCDECL, FuncDeclaration::DEF, 0, {}, 2);
+		link(node, 0, def.prot.get());
+		link(node, 1, def.block.get());
+		last = node;
+	}
+
+	virtual void visit(const Block& block) override {
+		auto node = add(Node::BLOCK, 0, block.level, {}, block.statements.size());
+		for (size_t i = 0; i < block.statements.size(); i++)
+			link(node, i, block.statements[i].get());
+		last = node;
+	}
+
+	virtual void visit(const Expr& expr) override {
+		auto node = add(Node::EXPRESSION, expr.type, expr.symbol, expr.value, expr.branches.size());
+		for (size_t i = 0; i < expr.branches.size(); i++)
+			link(node, i, expr.branches[i].get());
+		last = node;
+	}
+
+	virtual void visit(const Conditional& cond) override {
+		auto node = add(Node::CONDITIONAL, cond.type, 0, {}, cond.condition ? 2 : 1);
+		if (cond.condition)
+			link(node, 0, cond.condition.get());
+		link(node, cond.condition ? 1 : 0, cond.block.get());
+		last = node;
+	}
+
+	virtual void visit(const Loop& loop) override {
+		auto node = add(Node::LOOP, 0, 0, {}, 2);
+		link(node, 0, loop.condition.get());
+		link(node, 1, loop.block.get());
+		last = node;
+	}
+
+	virtual void visit(const Return& ret) override {
+		auto node = add(Node::RETURN, 0, 0, {}, ret.ret_expr ? 1 : 0);
+		if (ret.ret_expr)
+			link(node, 0, ret.ret_expr.get());
+		last = node;
+	}
+
+	virtual void visit(const Jump& jump) override {
+		last = add(Node::JUMP, jump.type, 0, {}, 0);
+	}
+};
+
+
+FlatAST FlatAST::from(const AST& ast) {
+	FlatAST flat;
+	flat.symbols = ast.symbols;
+	Builder builder(flat);
+	builder.visit(ast);
+
+	flat.kinds.shrink_to_fit();
+	flat.subkinds.shrink_to_fit();
+	flat.payloads.shrink_to_fit();
+	flat.texts.shrink_to_fit();
+	flat.first.shrink_to_fit();
+	flat.count.shrink_to_fit();
+	flat.children.shrink_to_fit();
+	flat.strings.shrink_to_fit();
+	return flat;
+}
+
+
+size_t FlatAST::memory() const {
+	return kinds.capacity() * sizeof(Node::NodeType) + subkinds.capacity() * sizeof(uint8_t) +
+		   payloads.capacity() * sizeof(uint32_t) + texts.capacity() * sizeof(Index) +
+		   first.capacity() * sizeof(Index) + count.capacity() * sizeof(uint32_t) +
+		   children.capacity() * sizeof(Index) + strings.capacity() * sizeof(string_view) +
+		   roots.capacity() * sizeof(Index);
+}
+
+
+void FlatAST::accept(FlatConstVisitor& v) const {
+	v.visit_root(*this);
+}
+
+
+void FlatAST::accept(FlatConstVisitor& v, const Index& node) const {
+	switch (kinds[node]) {
+		case Node::VARDECL:
+			v.visit_var_declaration(*this, node);
+			break;
+		case Node::FUNCDECL:
+			if (subkinds[node] == FuncDeclaration::PROT)
+				v.visit_func_prot(*this, node);
+			else
+				v.visit_func_def(*this, node);
+			break;
+		case Node::BLOCK:
+			v.visit_block(*this, node);
+			break;
+		case Node::EXPRESSION:
+			v.visit_expr(*this, node);
+			break;
+		case Node::CONDITIONAL:
+			v.visit_conditional(*this, node);
+			break;
+		case Node::LOOP:
+			v.visit_loop(*this, node);
+			break;
+		case Node::RETURN:
+			v.visit_return(*this, node);
+			break;
+		case Node::JUMP:
+			v.visit_jump(*this, node);
+			break;
+		case Node::STRING:
+			break;
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+
+#include "tree.hpp"
+
+
+class FlatConstVisitor;
+
+
+// Structure-of-arrays form of an AST. Node i is described by the i-th entry of
+// every column; its children are children[first[i] .. first[i] + count[i]).
+// Nodes are numbered in preorder, so a subtree is a contiguous index range.
+//
+//   kind         subkind           payload      text            children
+//   VARDECL      -                 var name     datatype        [value]
+//   FUNCDECL     FuncType PROT     func name    return type     args...
+//   FUNCDECL     FuncType DEF      -            -               prot, block
+//   BLOCK        -                 level        -               statements...
+//   EXPRESSION   ExprType          VAR/FUNC     literal or op   branches...
+//   CONDITIONAL  ConditionType     -            -               [condition], block
+//   LOOP         -                 -            -               condition, block
+//   RETURN       -                 -            -               expr
+//   JUMP         JumpType          -            -               -
+class FlatAST {
+public:
+	using Index = uint32_t;
+	static constexpr Index none = UINT32_MAX;
+
+	vector<Node::NodeType> kinds;
+	vector<uint8_t> subkinds;
+	vector<uint32_t> payloads;
+	vector<Index> texts; // into strings, none if the node has no text
+	vector<Index> first;
+	vector<uint32_t> count;
+
+	vector<Index> children;
+	vector<string_view> strings;
+	vector<Index> roots; // top-level declarations
+	shared_ptr<SymbolTable> symbols;
+
+	static FlatAST from(const AST&);
+
+	size_t size() const { return kinds.size(); }
+	Index child(const Index& node, const uint32_t& i) const { return children[first[node] + i]; }
+	string_view text(const Index& node) const { return texts[node] == none ? string_view() : strings[texts[node]]; }
+	size_t memory() const;
+
+	void accept(FlatConstVisitor&) const;
+	void accept(FlatConstVisitor&, const Index&) const;
+
+private:
+	class Builder;
+};
+
+
+
+class FlatConstVisitor {
+public:
+	virtual void visit_root(const FlatAST&) = 0;
+	virtual void visit_var_declaration(const FlatAST&, const FlatAST::Index&) = 0;
+	virtual void visit_func_prot(const FlatAST&, const FlatAST::Index&) = 0;
+	virtual void visit_func_def(const FlatAST&, const FlatAST::Index&) = 0;
+	virtual void visit_block(const FlatAST&, const FlatAST::Index&) = 0;
+	virtual void visit_expr(const FlatAST&, const FlatAST::Index&) = 0;
+	virtual void visit_conditional(const FlatAST&, const FlatAST::Index&) = 0;
+	virtual void visit_loop(const FlatAST&, const FlatAST::Index&) = 0;
+	virtual void visit_return(const FlatAST&, const FlatAST::Index&) = 0;
+	virtual void visit_jump(const FlatAST&, const FlatAST::Index&) = 0;
+};
@@ -0,0 +1,300 @@
+#include "folder.hpp"
+#include "resolver.hpp"
+#include <charconv>
+
+
+size_t Folder::fold(AST& ast) {
+    Folder folder;
+    folder.visit(ast);
+    return folder.removed;
+}
+
+
+bool Folder::constant(const Expr& expr, Constant& value) {
+    if (expr.type == Expr::CONST) {
+        value = expr.is_integer() ? Constant::of(expr.integer) : Constant::of(expr.number);
+        return true;
+    }
+    if (expr.type == Expr::CHAR) {
+        value = Constant::of(int64_t(expr.value.empty() ? 0 : expr.value[0]));
+        return true;
+    }
+    return false;
+}
+
+
+bool Folder::evaluate_integral(const Expr::Operator& op, const int64_t& a, const int64_t& b, Constant& result) {
+    uint64_t x = a, y = b;
+    switch (op) {
+        case Expr::ADD: result = Constant::of(int64_t(x + y)); break;
+        case Expr::SUB: result = Constant::of(int64_t(x - y)); break;
+        case Expr::MUL: result = Constant::of(int64_t(x * y)); break;
+        case Expr::DIV:
+            if (b == 0)
+                return false; // left to fail at run time
+            result = Constant::of(b == -1 ? int64_t(0 - x) : a / b);
+            break;
+        case Expr::MOD:
+            if (b == 0)
+                return false;
+            result = Constant::of(b == -1 ? int64_t(0) : a % b);
+            break;
+        case Expr::POW: result = Constant::of(pow(double(a), double(b))); break;
+        case Expr::EQ: result = Constant::of(int64_t(a == b)); break;
+        case Expr::NE: result = Constant::of(int64_t(a != b)); break;
+        case Expr::LT: result = Constant::of(int64_t(a < b)); break;
+        case Expr::LE: result = Constant::of(int64_t(a <= b)); break;
+        case Expr::GT: result = Constant::of(int64_t(a > b)); break;
+        case Expr::GE: result = Constant::of(int64_t(a >= b)); break;
+        case Expr::AND: result = Constant::of(int64_t(a != 0 && b != 0)); break;
+        case Expr::OR: result = Constant::of(int64_t(a != 0 || b != 0)); break;
+        default: return false;
+    }
+    return isfinite(result.number);
+}
+
+
+bool Folder::evaluate(const Expr& expr, Constant& result) {
+    Constant left, right;
+    double a = 0, b = 0;
+
+    switch (expr.type) {
+        case Expr::PRE_UNARY_OP:
+            if (!constant(*expr.branches[0], left))
+                return false;
+            switch (expr.op) {
+                case Expr::ADD: result = left; break;
+                case Expr::SUB:
+                    result = left.integral ? Constant::of(int64_t(0 - uint64_t(left.integer))) : Constant::of(-left.number);
+                    break;
+                case Expr::NOT: result = Constant::of(int64_t(left.number == 0)); break;
+                default: return false;
+            }
+            break;
+
+        case Expr::BINARY_OP:
+            if (!constant(*expr.branches[0], left) || !constant(*expr.branches[1], right))
+                return false;
+            if (left.integral && right.integral)
+                return evaluate_integral(expr.op, left.integer, right.integer, result);
+            a = left.number;
+            b = right.number;
+            switch (expr.op) {
+                case Expr::ADD: result = Constant::of(a + b); break;
+                case Expr::SUB: result = Constant::of(a - b); break;
+                case Expr::MUL: result = Constant::of(a * b); break;
+                case Expr::DIV:
+                    if (b == 0)
+                        return false; // left to fail at run time
+                    result = Constant::of(a / b);
+                    break;
+                case Expr::MOD:
+                    if (b == 0)
+                        return false;
+                    result = Constant::of(fmod(a, b));
+                    break;
+                case Expr::POW: result = Constant::of(pow(a, b)); break;
+                case Expr::EQ: result = Constant::of(int64_t(a == b)); break;
+                case Expr::NE: result = Constant::of(int64_t(a != b)); break;
+                case Expr::LT: result = Constant::of(int64_t(a < b)); break;
+                case Expr::LE: result = Constant::of(int64_t(a <= b)); break;
+                case Expr::GT: result = Constant::of(int64_t(a > b)); break;
+                case Expr::GE: result = Constant::of(int64_t(a >= b)); break;
+                case Expr::AND: result = Constant::of(int64_t(a != 0 && b != 0)); break;
+                case Expr::OR: result = Constant::of(int64_t(a != 0 || b != 0)); break;
+                default: return false;
+            }
+            break;
+
+        case Expr::MATH_FUNC:
+            if (expr.branches.size() != (expr.op == Expr::POW ? 2u : 1u) || !constant(*expr.branches[0], left) ||
+                (expr.op == Expr::POW && !constant(*expr.branches[1], right)))
+                return false;
+            a = left.number;
+            b = right.number;
+            switch (expr.op) {
+                case Expr::POW: result = Constant::of(pow(a, b)); break;
+                case Expr::SIN: result = Constant::of(sin(a)); break;
+                case Expr::COS: result = Constant::of(cos(a)); break;
+                case Expr::EXP: result = Constant::of(exp(a)); break;
+                case Expr::LOG: result = Constant::of(log(a)); break;
+                default: return false;
+            }
+            break;
+
+        default:
+            return false;
+    }
+    return isfinite(result.number);
+}
+
+
+node_ptr<Expr> Folder::make_constant(const Constant& value) {
+    char buffer[512]; // fixed notation of the largest double
+    auto end = value.integral ? to_chars(buffer, buffer + sizeof(buffer), value.integer).ptr
+                              : to_chars(buffer, buffer + sizeof(buffer), value.number).ptr;
+    string text(buffer, end);
+    if (!value.integral && text.find_first_of(".e") == string::npos)
+        text += ".0"; // keep the literal a double
+    ast->texts.push_back(move(text));
+    auto node = make_node<Expr>(ast->arena.get(), Expr::CONST, string_view(ast->texts.back()));
+    node->number = value.number;
+    node->integer = value.integer;
+    return node;
+}
+
+
+string_view Folder::datatype(const Expr& var) const {
+    const auto& types = var.binding.depth == 0 ? global_types : local_types;
+    return var.binding.slot < types.size() ? types[var.binding.slot] : string_view();
+}
+
+
+// Whether the expression is known to have an int, char or bool value; false
+// when it may be a double or its type is not known before type checking.
+bool Folder::integral(const Expr& expr) const {
+    switch (expr.type) {
+        case Expr::CONST:
+            return expr.is_integer();
+        case Expr::CHAR:
+            return true;
+        case Expr::VAR: {
+            auto type = datatype(expr);
+            return type == "int" || type == "char" || type == "bool";
+        }
+        case Expr::CAST:
+            return is_integral_type(expr.value_type);
+        case Expr::BINARY_OP:
+            if (expr.is_comparison() || expr.op == Expr::AND || expr.op == Expr::OR)
+                return true;
+            if (expr.op == Expr::ASSIGN)
+                return integral(*expr.branches[0]);
+            return expr.op != Expr::POW && integral(*expr.branches[0]) && integral(*expr.branches[1]);
+        case Expr::PRE_UNARY_OP:
+        case Expr::POST_UNARY_OP:
+            return expr.op == Expr::NOT || integral(*expr.branches[0]);
+        default:
+            return false;
+    }
+}
+
+
+void Folder::declare(const VarDeclaration& var) {
+    auto& types = var.binding.depth == 0 ? global_types : local_types;
+    if (types.size() <= var.binding.slot)
+        types.resize(var.binding.slot + 1);
+    types[var.binding.slot] = var.datatype;
+}
+
+
+void Folder::fold(node_ptr<Expr>& slot) {
+    Expr& expr = *slot;
+    for (auto& it : expr.branches)
+        fold(it);
+
+    Constant value;
+    if (evaluate(expr, value)) {
+        removed += expr.branches.size();
+        slot = make_constant(value);
+        return;
+    }
+    if (expr.type != Expr::BINARY_OP)
+        return;
+
+    auto op = expr.op;
+    auto& left = expr.branches[0];
+    auto& right = expr.branches[1];
+    // only integer literals: x * 1.0 would turn an int x into a double
+    auto is = [](const node_ptr<Expr>& operand, const double& value) {
+        return operand->is_integer() && operand->number == value;
+    };
+    bool double_var = left->type == Expr::VAR && datatype(*left) == "double";
+
+    // x + 0 is not x for a double x == -0.0, whose sum is +0.0
+    int keep = -1;
+    if ((op == Expr::MUL && is(right, 1)) || (op == Expr::SUB && is(right, 0)) ||
+        (op == Expr::ADD && is(right, 0) && integral(*left)) || (op == Expr::DIV && is(right, 1)) ||
+        (op == Expr::POW && is(right, 1) && double_var))
+        keep = 0;
+    else if ((op == Expr::MUL && is(left, 1)) || (op == Expr::ADD && is(left, 0) && integral(*right)))
+        keep = 1;
+    if (keep >= 0) {
+        auto kept = move(expr.branches[keep]);
+        slot = move(kept);
+        removed += 2;
+        return;
+    }
+
+    if (op == Expr::POW && is(right, 2) && double_var) {
+        auto copy = make_node<Expr>(ast->arena.get(), Expr::VAR, left->symbol);
+        copy->binding = left->binding;
+        expr.op = Expr::MUL;
+        expr.value = "*";
+        right = move(copy);
+    }
+}
+
+
+void Folder::visit(AST& root) {
+    Resolver::resolve(root); // variable types are tracked by binding
+    ast = &root;
+    for (auto& it : root.declarations)
+        it->accept(*this);
+}
+
+
+void Folder::visit(VarDeclaration& var) {
+    if (var.value)
+        fold(var.value);
+    declare(var);
+}
+
+
+void Folder::visit(FuncProt& prot) {
+    for (auto& arg : prot.args)
+        if (arg->value)
+            fold(arg->value);
+}
+
+
+void Folder::visit(FuncDef& def) {
+    def.prot->accept(*this);
+    local_types.assign(def.frame_size, {});
+    for (auto& arg : def.prot->args)
+        declare(*arg);
+    def.block->accept(*this);
+}
+
+
+void Folder::visit(Block& block) {
+    for (auto& it : block.statements)
+        it->accept(*this);
+}
+
+
+void Folder::visit(Expr& expr) {
+    for (auto& it : expr.branches)
+        fold(it);
+}
+
+
+void Folder::visit(Conditional& cond) {
+    if (cond.condition)
+        fold(cond.condition);
+    cond.block->accept(*this);
+}
+
+
+void Folder::visit(Loop& loop) {
+    fold(loop.condition);
+    loop.block->accept(*this);
+}
+
+
+void Folder::visit(Return& ret) {
+    if (ret.ret_expr)
+        fold(ret.ret_expr);
+}
+
+
+void Folder::visit(Jump&) {}
@@ -0,0 +1,55 @@
+#pragma once
+
+
+#include "tree.hpp"
+#include "../visitor.hpp"
+
+
+// Optimization pass over expressions. Constant BINARY_OP, PRE_UNARY_OP and
+// MATH_FUNC subtrees become CONST nodes carrying their value, and identities
+// that keep both value and type are applied: x * 1, x - 0, x / 1, x + 0 for
+// integral x (-0.0 + 0 is +0.0), and for double variables x ** 1 and x ** 2 -> x * x. Integer operands fold in
+// int64 with the VM's semantics: wrapping arithmetic and truncating division;
+// a division by a zero constant is left to fail at run time.
+class Folder : public Visitor {
+public:
+    // Returns the number of nodes removed from the tree.
+    static size_t fold(AST&);
+
+private:
+    AST* ast = nullptr;
+    size_t removed = 0;
+    vector<string_view> global_types; // declared datatype by global slot
+    vector<string_view> local_types; // and by frame slot of the current function
+
+    // A literal or folded value, exact in `integer` when it is integral.
+    struct Constant {
+        double number = 0;
+        int64_t integer = 0;
+        bool integral = false;
+
+        static Constant of(const int64_t& value) { return {double(value), value, true}; }
+        static Constant of(const double& value) { return {value, 0, false}; }
+    };
+
+    void fold(node_ptr<Expr>&);
+    static bool constant(const Expr&, Constant&);
+    static bool evaluate(const Expr&, Constant&);
+    static bool evaluate_integral(const Expr::Operator&, const int64_t&, const int64_t&, Constant&);
+    node_ptr<Expr> make_constant(const Constant&);
+    string_view datatype(const Expr&) const;
+    bool integral(const Expr&) const;
+    void declare(const VarDeclaration&);
+
+public:
+    virtual void visit(AST&) override;
+    virtual void visit(VarDeclaration&) override;
+    virtual void visit(FuncProt&) override;
+    virtual void visit(FuncDef&) override;
+    virtual void visit(Block&) override;
+    virtual void visit(Expr&) override;
+    virtual void visit(Conditional&) override;
+    virtual void visit(Loop&) override;
+    virtual void visit(Return&) override;
+    virtual void visit(Jump&) override;
+};
@@ -0,0 +1,136 @@
+#include "resolver.hpp"
+
+
+void Resolver::resolve(AST& ast) {
+    Resolver resolver;
+    resolver.visit(ast);
+}
+
+
+void Resolver::open_scope() {
+    if (scopes.size() >= Binding::unresolved)
+        throw runtime_error("Resolver: Blocks are nested too deeply");
+    scopes.emplace_back();
+}
+
+
+void Resolver::close_scope() {
+    for (auto name : scopes.back())
+        visible[name].pop_back();
+    scopes.pop_back();
+}
+
+
+void Resolver::declare(VarDeclaration& var) {
+    if (visible.size() <= var.var_name)
+        visible.resize(var.var_name + 1);
+    auto& bindings = visible[var.var_name];
+    uint16_t depth = scopes.size() - 1;
+
+    if (!bindings.empty() && bindings.back().depth == depth) {
+        if (depth != 0)
+            throw runtime_error("Resolver: Redeclaration of " + symbols->name(var.var_name));
+        var.binding = bindings.back(); // a global may be declared again and keeps its slot
+        return;
+    }
+
+    if (depth == 0) {
+        if (globals == UINT16_MAX)
+            throw runtime_error("Resolver: Too many global variables");
+        var.binding = {depth, globals++};
+    } else {
+        if (next_slot == UINT16_MAX)
+            throw runtime_error("Resolver: Too many variables in one function");
+        var.binding = {depth, next_slot++};
+        function->frame_size = max(function->frame_size, next_slot);
+    }
+    bindings.push_back(var.binding);
+    scopes.back().push_back(var.var_name);
+}
+
+
+Binding Resolver::lookup(const Symbol& name) const {
+    if (name >= visible.size() || visible[name].empty())
+        throw runtime_error("Resolver: Undeclared variable " + symbols->name(name));
+    return visible[name].back();
+}
+
+
+void Resolver::visit(AST& root) {
+    symbols = root.symbols.get();
+    visible.assign(symbols->size(), {});
+    open_scope();
+    for (auto& it : root.declarations)
+        it->accept(*this);
+    close_scope();
+}
+
+
+void Resolver::visit(VarDeclaration& var) {
+    if (var.value)
+        var.value->accept(*this); // before declaring: the initializer cannot see the new variable
+    declare(var);
+}
+
+
+void Resolver::visit(FuncProt& prot) {
+    // Default arguments are evaluated by the caller, so they may only refer to globals.
+    for (auto& arg : prot.args)
+        if (arg->value)
+            arg->value->accept(*this);
+}
+
+
+void Resolver::visit(FuncDef& def) {
+    def.prot->accept(*this);
+    function = &def;
+    def.frame_size = 0;
+    next_slot = 0;
+
+    open_scope();
+    for (auto& arg : def.prot->args)
+        declare(*arg);
+    def.block->accept(*this);
+    close_scope();
+    function = nullptr;
+}
+
+
+void Resolver::visit(Block& block) {
+    auto first_slot = next_slot; // slots of a finished block are reused by its siblings
+    open_scope();
+    for (auto& it : block.statements)
+        it->accept(*this);
+    close_scope();
+    next_slot = first_slot;
+}
+
+
+void Resolver::visit(Expr& expr) {
+    if (expr.type == Expr::VAR)
+        expr.binding = lookup(expr.symbol);
+    for (auto& it : expr.branches)
+        it->accept(*this);
+}
+
+
+void Resolver::visit(Conditional& cond) {
+    if (cond.condition)
+        cond.condition->accept(*this);
+    cond.block->accept(*this);
+}
+
+
+void Resolver::visit(Loop& loop) {
+    loop.condition->accept(*this);
+    loop.block->accept(*this);
+}
+
+
+void Resolver::visit(Return& ret) {
+    if (ret.ret_expr)
+        ret.ret_expr->accept(*this);
+}
+
+
+void Resolver::visit(Jump&) {}
@@ -0,0 +1,39 @@
+#pragma once
+
+
+#include "tree.hpp"
+#include "../visitor.hpp"
+
+
+// Semantic pass that binds every variable reference to the declaration it
+// names. Each VarDeclaration and VAR expression gets a Binding, each FuncDef
+// its frame size, so executors index frames instead of looking names up.
+class Resolver : public Visitor {
+public:
+    static void resolve(AST&);
+
+private:
+    const SymbolTable* symbols = nullptr;
+    vector<vector<Binding>> visible; // by symbol: innermost binding last
+    vector<vector<Symbol>> scopes; // names declared in each open scope
+    uint16_t globals = 0;
+    uint16_t next_slot = 0;
+    FuncDef* function = nullptr;
+
+    void open_scope();
+    void close_scope();
+    void declare(VarDeclaration&);
+    Binding lookup(const Symbol&) const;
+
+public:
+    virtual void visit(AST&) override;
+    virtual void visit(VarDeclaration&) override;
+    virtual void visit(FuncProt&) override;
+    virtual void visit(FuncDef&) override;
+    virtual void visit(Block&) override;
+    virtual void visit(Expr&) override;
+    virtual void visit(Conditional&) override;
+    virtual void visit(Loop&) override;
+    virtual void visit(Return&) override;
+    virtual void visit(Jump&) override;
+};
@@ -1,14 +1,24 @@
 #include "syntaxer.hpp"
+#include <optional>
 
 
-int Syntaxer::level = 1;
+Syntaxer::Syntaxer(Arena* arena) : arena(arena) {}
 
 
-unique_ptr<AST> Syntaxer::parse(const vector<Token>& tokens) {
+unique_ptr<AST> Syntaxer::parse(const TokenList& tokens, shared_ptr<Arena> arena) {
+    TokenCursor cursor(tokens);
+    return parse(cursor, move(arena));
+}
+
+
+unique_ptr<AST> Syntaxer::parse(TokenCursor& tokens, shared_ptr<Arena> arena) {
+    Syntaxer syntaxer(arena.get());
     unique_ptr<AST> root = make_unique<AST>();
+    root->arena = move(arena);
+    root->symbols = tokens.symbols;
     size_t pos = 0;
-    while (pos < tokens.size()) {
-        auto declaration_list = parse_declaration(tokens, pos);
+    while (tokens.has(pos)) {
+        auto declaration_list = syntaxer.parse_declaration(tokens, pos);
         for (auto& it : declaration_list)
             root->declarations.push_back(move(it));
     }
@@ -17,16 +27,79 @@ unique_ptr<AST> Syntaxer::parse(const vector<Token>& tokens) {
 }
 
 
-vector<unique_ptr<Declaration>> Syntaxer::parse_declaration(const vector<Token>& tokens, size_t& pos) {
-    vector<unique_ptr<Declaration>> declarations;
+unique_ptr<AST> Syntaxer::parse(const TokenList& tokens, WorkPool& pool, shared_ptr<Arena> arena) {
+    auto bounds = declaration_bounds(tokens);
+    size_t count = bounds.size() - 1;
+    unique_ptr<AST> root = make_unique<AST>();
+    if (arena)
+        for (size_t i = 0; i < pool.size(); i++)
+            root->worker_arenas.push_back(make_shared<Arena>());
+
+    // A declaration that fails to parse, or does not end where the scan said,
+    // is left to the sequential parser to report exactly as it would.
+    vector<optional<node_list<Declaration>>> parsed(count); // each list keeps its worker's arena
+    vector<char> failed(count);
+    pool.run(count, [&](size_t i, size_t worker) {
+        Syntaxer syntaxer(arena ? root->worker_arenas[worker].get() : nullptr);
+        TokenCursor cursor(tokens);
+        size_t pos = bounds[i];
+        try {
+            parsed[i].emplace(syntaxer.parse_declaration(cursor, pos));
+            failed[i] = pos != bounds[i + 1];
+        } catch (const exception&) {
+            failed[i] = true;
+        }
+    });
+    if (find(failed.begin(), failed.end(), true) != failed.end())
+        return parse(tokens, move(arena));
+
+    root->arena = move(arena);
+    root->symbols = tokens.symbols;
+    for (auto& list : parsed)
+        for (auto& it : *list)
+            root->declarations.push_back(move(it));
+    return root;
+}
+
+
+// Token index where each top-level declaration starts, plus the end: a
+// declaration ends with a ';' outside braces or with the '}' closing its body.
+vector<size_t> Syntaxer::declaration_bounds(const TokenList& tokens) {
+    vector<size_t> bounds{0};
+    size_t depth = 0;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        switch (tokens[i].type) {
+            case Token::LCURLYBRACKET:
+                depth++;
+                break;
+            case Token::RCURLYBRACKET:
+                if (depth && --depth == 0)
+                    bounds.push_back(i + 1);
+                break;
+            case Token::SEMICOLON:
+                if (!depth)
+                    bounds.push_back(i + 1);
+                break;
+            default:
+                break;
+        }
+    }
+    if (bounds.back() != tokens.size())
+        bounds.push_back(tokens.size());
+    return bounds;
+}
+
+
+node_list<Declaration> Syntaxer::parse_declaration(TokenCursor& tokens, size_t& pos) {
+    auto declarations = list<Declaration>();
     
-    if (tokens[pos].type == Token::DATATYPE && (tokens[pos + 1].type == Token::IDENTIFIER || (tokens[pos + 1].type == Token::KEYWORD && tokens[pos + 1].value == "main")) && tokens[pos + 2].type == Token::LPAREN) {
+    if (tokens[pos].type == Token::DATATYPE && (tokens[pos + 1].type == Token::IDENTIFIER || (tokens[pos + 1].type == Token::KEYWORD && tokens[pos + 1].symbol == SymbolTable::MAIN)) && tokens[pos + 2].type == Token::LPAREN) {
         declarations.push_back(parse_func_declaration(tokens, pos));
         return declarations;
     } else if (tokens[pos].type == Token::DATATYPE && tokens[pos + 1].type == Token::IDENTIFIER) {
         auto vardecl = parse_var_declaration(tokens, pos);
         for (auto& it : vardecl)
-            declarations.push_back(unique_ptr<VarDeclaration>(move(it)));
+            declarations.push_back(node_ptr<VarDeclaration>(move(it)));
         return declarations;
     } else {
         throw runtime_error("Syntaxer::parse_declaration(): Invalid declaration");
@@ -34,9 +107,9 @@ vector<unique_ptr<Declaration>> Syntaxer::parse_declaration(const vector<Token>&
 }
 
 
-vector<unique_ptr<VarDeclaration>> Syntaxer::parse_var_declaration(const vector<Token>& tokens, size_t& pos) {
-    vector<unique_ptr<VarDeclaration>> declarations;
-    Token datatype = tokens[pos++];
+node_list<VarDeclaration> Syntaxer::parse_var_declaration(TokenCursor& tokens, size_t& pos) {
+    auto declarations = list<VarDeclaration>();
+    auto datatype = tokens.text(pos++);
 
     while (tokens[pos].type != Token::SEMICOLON) {
         if (tokens[pos].type == Token::COMMA) {
@@ -46,11 +119,13 @@ vector<unique_ptr<VarDeclaration>> Syntaxer::parse_var_declaration(const vector<
         
         if (tokens[pos].type == Token::IDENTIFIER &&
             tokens[pos + 1].type == Token::ASSIGNMENT) {
-                auto var_name = tokens[pos].value;
+                auto var_name = tokens[pos].symbol;
+                auto offset = tokens[pos].offset;
                 pos += 2;
-                declarations.push_back(make_unique<VarDeclaration>(datatype.value, var_name, parse_binary_expression(tokens, pos)));
+                declarations.push_back(make_at<VarDeclaration>(offset, datatype, var_name, parse_binary_expression(tokens, pos)));
         } else if (tokens[pos].type == Token::IDENTIFIER) {
-            declarations.push_back(make_unique<VarDeclaration>(datatype.value, tokens[pos++].value));
+            declarations.push_back(make_at<VarDeclaration>(tokens[pos].offset, datatype, tokens[pos].symbol));
+            pos++;
         }
         else
             throw runtime_error("Syntaxer::parse_var_declaration(): Invalid variable declaration");
@@ -60,33 +135,35 @@ vector<unique_ptr<VarDeclaration>> Syntaxer::parse_var_declaration(const vector<
 }
 
 
-vector<unique_ptr<VarDeclaration>> Syntaxer::parse_func_args(const vector<Token>& tokens, size_t& pos) {
-    vector<unique_ptr<VarDeclaration>> args;
+node_list<VarDeclaration> Syntaxer::parse_func_args(TokenCursor& tokens, size_t& pos) {
+    auto args = list<VarDeclaration>();
     while (tokens[pos].type != Token::RPAREN) {
         if (tokens[pos].type == Token::COMMA)
             pos++;
         if (tokens[pos].type == Token::DATATYPE && tokens[pos + 1].type == Token::IDENTIFIER) {
-            string type = tokens[pos++].value, name = tokens[pos++].value;
-            args.push_back(make_unique<VarDeclaration>(type, name));
-        }
+            args.push_back(make_at<VarDeclaration>(tokens[pos].offset, tokens.text(pos), tokens[pos + 1].symbol));
+            pos += 2;
+        } else
+            throw runtime_error("Syntaxer::parse_func_args(): Invalid function argument");
     }
 
     return args;
 }
 
 
-unique_ptr<FuncDeclaration> Syntaxer::parse_func_declaration(const vector<Token>& tokens, size_t& pos) {
-    string return_type = tokens[pos++].value;
-    string func_name = tokens[pos++].value;
+node_ptr<FuncDeclaration> Syntaxer::parse_func_declaration(TokenCursor& tokens, size_t& pos) {
+    auto offset = tokens[pos].offset;
+    auto return_type = tokens.text(pos++);
+    auto func_name = tokens[pos++].symbol;
     
     expect_token(Token::LPAREN, tokens, pos);
     auto args = parse_func_args(tokens, pos);
     expect_token(Token::RPAREN, tokens, pos);
-    unique_ptr<FuncProt> prot = make_unique<FuncProt>(return_type, func_name, move(args));
+    node_ptr<FuncProt> prot = make_at<FuncProt>(offset, return_type, func_name, move(args));
 
     if (tokens[pos].type == Token::LCURLYBRACKET) {
         pos++;
-        return make_unique<FuncDef>(move(prot), parse_block(tokens, pos));
+        return make_at<FuncDef>(offset, move(prot), parse_block(tokens, pos));
     } else if (tokens[pos].type == Token::SEMICOLON) {
         pos++;
         return prot;
@@ -95,13 +172,15 @@ unique_ptr<FuncDeclaration> Syntaxer::parse_func_declaration(const vector<Token>
 }
 
 
-unique_ptr<Block> Syntaxer::parse_block(const vector<Token>& tokens, size_t& pos) {
+node_ptr<Block> Syntaxer::parse_block(TokenCursor& tokens, size_t& pos) {
     level++;
-    vector<unique_ptr<Statement>> statements;
+    auto statements = list<Statement>();
 
     while (tokens[pos].type != Token::RCURLYBRACKET) {
+        auto offset = tokens[pos].offset;
         if (tokens[pos].type == Token::IDENTIFIER && tokens[pos + 1].type == Token::ASSIGNMENT) {
-            unique_ptr<Expr> expr = parse_binary_expression(tokens, pos);
+            node_ptr<Expr> expr = parse_binary_expression(tokens, pos);
+            set_offset(expr.get(), offset);
             statements.push_back(move(expr));
             if (tokens[pos - 1].type != Token::RCURLYBRACKET)
                 expect_token(Token::SEMICOLON, tokens, pos);
@@ -110,142 +189,155 @@ unique_ptr<Block> Syntaxer::parse_block(const vector<Token>& tokens, size_t& pos
         if (tokens[pos].type == Token::DATATYPE && tokens[pos + 1].type == Token::IDENTIFIER) {
             auto declaration_list = parse_var_declaration(tokens, pos);
             for (auto& it : declaration_list)
-                statements.push_back(unique_ptr<VarDeclaration>(move(it)));
-        } else if (tokens[pos].type == Token::KEYWORD && (tokens[pos].value == "if" || tokens[pos].value == "elif" || tokens[pos].value == "else")) {
+                statements.push_back(node_ptr<VarDeclaration>(move(it)));
+        } else if (tokens[pos].type == Token::KEYWORD && (tokens[pos].symbol == SymbolTable::IF || tokens[pos].symbol == SymbolTable::ELIF || tokens[pos].symbol == SymbolTable::ELSE)) {
             statements.push_back(parse_conditional_statement(tokens, pos));
-        } else if (tokens[pos].type == Token::KEYWORD && tokens[pos].value == "while") {
+        } else if (tokens[pos].type == Token::KEYWORD && tokens[pos].symbol == SymbolTable::WHILE) {
             statements.push_back(parse_loop_statement(tokens, pos));
-        } else if (tokens[pos].type == Token::KEYWORD && tokens[pos].value == "return") {
+        } else if (tokens[pos].type == Token::KEYWORD && tokens[pos].symbol == SymbolTable::RETURN) {
             pos++;
             auto ret = parse_return_statement(tokens, pos);
+            set_offset(ret.get(), offset);
             if (tokens[pos - 1].type != Token::RCURLYBRACKET)
                 expect_token(Token::SEMICOLON, tokens, pos);
             statements.push_back(move(ret));
-        } else if (tokens[pos].type == Token::KEYWORD && (tokens[pos].value == "break" || tokens[pos].value == "continue")) {
+        } else if (tokens[pos].type == Token::KEYWORD && (tokens[pos].symbol == SymbolTable::BREAK || tokens[pos].symbol == SymbolTable::CONTINUE)) {
             auto jump = parse_jump_statement(tokens, pos);
             if (tokens[pos - 1].type != Token::RCURLYBRACKET)
                 expect_token(Token::SEMICOLON, tokens, pos);
             statements.push_back(move(jump));
         } else {
             statements.push_back(parse_binary_expression(tokens, pos));
+            set_offset(statements.back().get(), offset);
             if (tokens[pos - 1].type != Token::RCURLYBRACKET)
                 expect_token(Token::SEMICOLON, tokens, pos);
         }
     }
 
     expect_token(Token::RCURLYBRACKET, tokens, pos);
-    return make_unique<Block>(move(statements), --level);
+    return make<Block>(move(statements), --level);
 }
 
 
-unique_ptr<Conditional> Syntaxer::parse_conditional_statement(const vector<Token>& tokens, size_t& pos) {
-    string keyword = tokens[pos++].value;
-    vector<unique_ptr<Statement>> statement_list;
+node_ptr<Conditional> Syntaxer::parse_conditional_statement(TokenCursor& tokens, size_t& pos) {
+    auto offset = tokens[pos].offset;
+    auto keyword = tokens[pos++].symbol;
 
-    if (keyword == "if" || keyword == "elif") {
+    if (keyword == SymbolTable::IF || keyword == SymbolTable::ELIF) {
         expect_token(Token::LPAREN, tokens, pos);
-        unique_ptr<Expr> condition = parse_binary_expression(tokens, pos);
+        node_ptr<Expr> condition = parse_binary_expression(tokens, pos);
         expect_token(Token::RPAREN, tokens, pos);
         expect_token(Token::LCURLYBRACKET, tokens, pos);
-        return make_unique<Conditional>(keyword == "if" ? Conditional::IF : Conditional::ELIF, move(condition), parse_block(tokens, pos));
+        return make_at<Conditional>(offset, keyword == SymbolTable::IF ? Conditional::IF : Conditional::ELIF, move(condition), parse_block(tokens, pos));
 
-    } else if (keyword == "else") {
+    } else if (keyword == SymbolTable::ELSE) {
         expect_token(Token::LCURLYBRACKET, tokens, pos);
-        return make_unique<Conditional>(Conditional::ELSE, parse_block(tokens, pos));
+        return make_at<Conditional>(offset, Conditional::ELSE, parse_block(tokens, pos));
     }
     
     throw runtime_error("Syntaxer::parse_conditional_statement(): Invalid conditional statement");
 }
 
 
-unique_ptr<Loop> Syntaxer::parse_loop_statement(const vector<Token>& tokens, size_t& pos) {
-    string keyword = tokens[pos++].value;
-    vector<unique_ptr<Statement>> statement_list;
-    
+node_ptr<Loop> Syntaxer::parse_loop_statement(TokenCursor& tokens, size_t& pos) {
+    auto offset = tokens[pos++].offset;
     expect_token(Token::LPAREN, tokens, pos);
-    unique_ptr<Expr> condition = parse_binary_expression(tokens, pos);
+    node_ptr<Expr> condition = parse_binary_expression(tokens, pos);
     expect_token(Token::RPAREN, tokens, pos);
     expect_token(Token::LCURLYBRACKET, tokens, pos);
-    return make_unique<Loop>(move(condition), parse_block(tokens, pos));
+    return make_at<Loop>(offset, move(condition), parse_block(tokens, pos));
 }
 
 
-unique_ptr<Return> Syntaxer::parse_return_statement(const vector<Token>& tokens, size_t& pos) {
-    return make_unique<Return>(parse_binary_expression(tokens, pos));
+node_ptr<Return> Syntaxer::parse_return_statement(TokenCursor& tokens, size_t& pos) {
+    return make<Return>(parse_binary_expression(tokens, pos));
 }
 
 
-unique_ptr<Jump> Syntaxer::parse_jump_statement(const vector<Token>& tokens, size_t& pos) {
-    return make_unique<Jump>(tokens[pos++].value == "break" ? Jump::BREAK : Jump::CONTINUE);
+node_ptr<Jump> Syntaxer::parse_jump_statement(TokenCursor& tokens, size_t& pos) {
+    auto offset = tokens[pos].offset;
+    return make_at<Jump>(offset, tokens[pos++].symbol == SymbolTable::BREAK ? Jump::BREAK : Jump::CONTINUE);
 }
 
 
-const unordered_map<string, int> Syntaxer::precedences = {
-    {"=", 1},
-    {"||", 2},
-    {"&&", 3},
-    {"==", 4}, {"!=", 4},
-    {"<", 5}, {"<=", 5}, {">", 5}, {">=", 5},
-    {"+", 6}, {"-", 6},
-    {"*", 7}, {"/", 7}, {"%", 7},
-    {"**", 8},
-};
+int Syntaxer::precedence(const Token::TokenType& type) {
+    switch (type) {
+        case Token::ASSIGNMENT: return 1;
+        case Token::LOGIC_OR: return 2;
+        case Token::LOGIC_AND: return 3;
+        case Token::EQUAL: case Token::NOTEQUAL: return 4;
+        case Token::COMPARISON: return 5; // <, <=, >, >=
+        case Token::PLUS: case Token::MINUS: return 6;
+        case Token::ASTERISK: case Token::SLASH: case Token::MODULO: return 7;
+        case Token::POWER: return 8;
+        default: return -1;
+    }
+}
 
 
-unique_ptr<Expr> Syntaxer::parse_binary_expression(const vector<Token>& tokens, size_t& pos, const int& min_precedence) {
+node_ptr<Expr> Syntaxer::parse_binary_expression(TokenCursor& tokens, size_t& pos, const int& min_precedence) {
 	auto left = parse_simple_expression(tokens, pos);
-	for (auto token = tokens[pos]; token.type != Token::COMMA || token.type != Token::SEMICOLON || token.type != Token::RPAREN; token = tokens[pos]) {
-		auto it = precedences.find(token.value);
-		if (it == precedences.end() || it -> second < min_precedence)
+	while (tokens.has(pos)) {
+		auto op_precedence = precedence(tokens[pos].type);
+		if (op_precedence < 0 || op_precedence < min_precedence)
 			break;
-		auto right = parse_binary_expression(tokens, ++pos, it -> second);
-        vector<unique_ptr<Expr>> branches;
+		auto op_type = tokens[pos].type;
+		auto op = tokens.text(pos);
+		// assignment and ** group to the right, everything else to the left
+		auto right_precedence = op_type == Token::ASSIGNMENT || op_type == Token::POWER ? op_precedence : op_precedence + 1;
+		auto right = parse_binary_expression(tokens, ++pos, right_precedence);
+        auto branches = list<Expr>();
         branches.push_back(move(left));
         branches.push_back(move(right));
-        left = make_unique<Expr>(Expr::BINARY_OP, token.value, move(branches));
-
+        left = make<Expr>(Expr::BINARY_OP, op, move(branches));
 	}
 
 	return left;
 }
 
 
-unique_ptr<Expr> Syntaxer::parse_simple_expression(const vector<Token>& tokens, size_t& pos) {
-	auto token = tokens[pos++];
+node_ptr<Expr> Syntaxer::parse_simple_expression(TokenCursor& tokens, size_t& pos) {
+	auto token = tokens[pos]; // by value: a streaming cursor may move its window below
+	auto value = tokens.text(pos++);
 	if (token.type == Token::NUMBER) {
-		return make_unique<Expr>(Expr::CONST, token.value);
+		return make<Expr>(Expr::CONST, value);
     } else if (token.type == Token::STRING) {
-        return make_unique<Expr>(Expr::STRING, token.value);
+        return make<Expr>(Expr::STRING, value);
     } else if (token.type == Token::CHAR) {
-        return make_unique<Expr>(Expr::CHAR, token.value);
+        return make<Expr>(Expr::CHAR, value);
     }  else if (token.type == Token::IDENTIFIER) {
 		if (tokens[pos].type == Token::LPAREN) {
-			vector<unique_ptr<Expr>> args = parse_interior(tokens, pos);
-			return make_unique<Expr>(Expr::FUNC, token.value, move(args));
+			node_list<Expr> args = parse_interior(tokens, pos);
+			return make<Expr>(Expr::FUNC, token.symbol, move(args));
+		} else if (tokens.has(pos) && (tokens[pos].type == Token::INCREMENT || tokens[pos].type == Token::DECREMENT)) {
+			auto op = tokens.text(pos++);
+			auto var = list<Expr>();
+			var.push_back(make<Expr>(Expr::VAR, token.symbol));
+			return make<Expr>(Expr::POST_UNARY_OP, op, move(var));
 		} else
-			return make_unique<Expr>(Expr::VAR, token.value);
+			return make<Expr>(Expr::VAR, token.symbol);
 	} else if (token.type == Token::BUILTIN_FUNC) {
 		if (tokens[pos].type == Token::LPAREN) {
-			vector<unique_ptr<Expr>> args = parse_interior(tokens, pos);
-			return make_unique<Expr>(Expr::BUILTIN_FUNC, token.value, move(args));
+			node_list<Expr> args = parse_interior(tokens, pos);
+			return make<Expr>(Expr::BUILTIN_FUNC, value, move(args));
 		}
 	} else if (token.type == Token::MATH_FUNC) {
-		return make_unique<Expr>(Expr::MATH_FUNC, token.value, parse_interior(tokens, pos));
+		return make<Expr>(Expr::MATH_FUNC, value, parse_interior(tokens, pos));
 	} else if (token.type == Token::PLUS || token.type == Token::MINUS || token.type == Token::INCREMENT || token.type == Token::DECREMENT || token.type == Token::NOT) {
-        vector<unique_ptr<Expr>> simple_expr;
+        auto simple_expr = list<Expr>();
         simple_expr.push_back(parse_simple_expression(tokens, pos));
-		return make_unique<Expr>(Expr::PRE_UNARY_OP, token.value, move(simple_expr));
+		return make<Expr>(Expr::PRE_UNARY_OP, value, move(simple_expr));
 	} else if (token.type == Token::LPAREN) {
 		auto node = parse_binary_expression(tokens, pos);
 		expect_token(Token::RPAREN, tokens, pos);
 		return node;
 	} else
-    	throw runtime_error("Syntaxer::parse_simple_expression(): Invalid token: " + token.value + " (pos: " + to_string(pos) + ")");
+    	throw runtime_error("Syntaxer::parse_simple_expression(): Invalid token: " + string(value) + " (pos: " + to_string(pos) + ")");
 }
 
 
-vector<unique_ptr<Expr>> Syntaxer::parse_interior(const vector<Token>& tokens, size_t& pos) {
-	vector<unique_ptr<Expr>> args;
+node_list<Expr> Syntaxer::parse_interior(TokenCursor& tokens, size_t& pos) {
+	auto args = list<Expr>();
 	expect_token(Token::LPAREN, tokens, pos);
     
     if (tokens[pos].type == Token::RPAREN) {
@@ -267,10 +359,9 @@ vector<unique_ptr<Expr>> Syntaxer::parse_interior(const vector<Token>& tokens, s
 }
 
 
-void Syntaxer::expect_token(const Token::TokenType& expected_type, const vector<Token>& tokens, size_t& pos) {
-	auto token = tokens[pos];
-	if (token.type == expected_type)
+void Syntaxer::expect_token(const Token::TokenType& expected_type, TokenCursor& tokens, size_t& pos) {
+	if (tokens.has(pos) && tokens[pos].type == expected_type)
 		pos++;
 	else
-		throw runtime_error("Syntaxer::expect_token(): Unexpected token: " + tokens[pos].value);
+		throw runtime_error("Syntaxer::expect_token(): Unexpected token: " + string(tokens.has(pos) ? tokens.text(pos) : "end of input"));
 }
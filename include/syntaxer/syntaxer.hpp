@@ -2,32 +2,63 @@
 
 
 #include "../lexer/lexer.hpp"
+#include "../lexer/cursor.hpp"
 #include "tree.hpp"
+#include "../work_pool.hpp"
 
 
 class Syntaxer {
 public:
-    static unique_ptr<AST> parse(const vector<Token>&);
+    // With an arena every node and child list is bump allocated from it and the
+    // tree is released at once together with the arena (AST::arena keeps it alive).
+    static unique_ptr<AST> parse(const TokenList&, shared_ptr<Arena> = nullptr);
+    // Consumes tokens as they are needed, so a streaming cursor keeps token memory bounded.
+    static unique_ptr<AST> parse(TokenCursor&, shared_ptr<Arena> = nullptr);
+    // Builds the same tree as parse(), with the top-level declarations parsed on
+    // the pool's workers. An arena is not shared between threads: each worker
+    // allocates from its own, kept in AST::worker_arenas.
+    static unique_ptr<AST> parse(const TokenList&, WorkPool&, shared_ptr<Arena> = nullptr);
 
 private:
-    static int level;
-	static const unordered_map<string, int> precedences;
+    int level = 1;
+    Arena* arena;
 
-    static vector<unique_ptr<Declaration>> parse_declaration(const vector<Token>&, size_t&);
-    static vector<unique_ptr<VarDeclaration>> parse_var_declaration(const vector<Token>&, size_t&);
-    static vector<unique_ptr<VarDeclaration>> parse_func_args(const vector<Token>&, size_t&);
-    static unique_ptr<FuncDeclaration> parse_func_declaration(const vector<Token>&, size_t&);
+    Syntaxer(Arena*);
 
-    static unique_ptr<Block> parse_block(const vector<Token>&, size_t&);
-    static unique_ptr<Conditional> parse_conditional_statement(const vector<Token>&, size_t&);
-    static unique_ptr<Loop> parse_loop_statement(const vector<Token>&, size_t&);
-    static unique_ptr<Return> parse_return_statement(const vector<Token>&, size_t&);
-    static unique_ptr<Jump> parse_jump_statement(const vector<Token>&, size_t&);
+    template<class T, class... Args>
+    node_ptr<T> make(Args&&... args) {
+        return make_node<T>(arena, forward<Args>(args)...);
+    }
 
-    static unique_ptr<Expr> parse_binary_expression(const vector<Token>&, size_t&, const int& = 0);
-	static unique_ptr<Expr> parse_simple_expression(const vector<Token>&, size_t&);
-	static vector<unique_ptr<Expr>> parse_interior(const vector<Token>&, size_t&);
-	static void expect_token(const Token::TokenType&, const vector<Token>&, size_t&);
+    // make() for a node that starts at source offset `offset`.
+    template<class T, class... Args>
+    node_ptr<T> make_at(const uint32_t& offset, Args&&... args) {
+        auto node = make<T>(forward<Args>(args)...);
+        set_offset(node.get(), offset);
+        return node;
+    }
 
-};
+    template<class T>
+    node_list<T> list() const {
+        return make_list<T>(arena);
+    }
+
+    static vector<size_t> declaration_bounds(const TokenList&);
+    node_list<Declaration> parse_declaration(TokenCursor&, size_t&);
+    node_list<VarDeclaration> parse_var_declaration(TokenCursor&, size_t&);
+    node_list<VarDeclaration> parse_func_args(TokenCursor&, size_t&);
+    node_ptr<FuncDeclaration> parse_func_declaration(TokenCursor&, size_t&);
+
+    node_ptr<Block> parse_block(TokenCursor&, size_t&);
+    node_ptr<Conditional> parse_conditional_statement(TokenCursor&, size_t&);
+    node_ptr<Loop> parse_loop_statement(TokenCursor&, size_t&);
+    node_ptr<Return> parse_return_statement(TokenCursor&, size_t&);
+    node_ptr<Jump> parse_jump_statement(TokenCursor&, size_t&);
 
+    static int precedence(const Token::TokenType&);
+    node_ptr<Expr> parse_binary_expression(TokenCursor&, size_t&, const int& = 0);
+	node_ptr<Expr> parse_simple_expression(TokenCursor&, size_t&);
+	node_list<Expr> parse_interior(TokenCursor&, size_t&);
+	static void expect_token(const Token::TokenType&, TokenCursor&, size_t&);
+
+};
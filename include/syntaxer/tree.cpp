@@ -1,5 +1,61 @@
 #include "tree.hpp"
 #include "../visitor.hpp"
+#include <charconv>
+
+void NodeDeleter::operator()(Node* node) const {
+	if (!node->in_arena)
+		delete node;
+}
+
+
+void NodeDeleter::operator()(VarDeclaration* var) const {
+	if (!static_cast<Statement*>(var)->in_arena)
+		delete var;
+}
+
+
+void mark_in_arena(Node* node) {
+	node->in_arena = true;
+}
+
+
+void mark_in_arena(VarDeclaration* var) {
+	static_cast<Declaration*>(var)->in_arena = true;
+	static_cast<Statement*>(var)->in_arena = true;
+}
+
+
+void set_offset(Node* node, const uint32_t& offset) {
+	node->offset = offset;
+}
+
+
+void set_offset(VarDeclaration* var, const uint32_t& offset) {
+	static_cast<Declaration*>(var)->offset = offset;
+	static_cast<Statement*>(var)->offset = offset;
+}
+
+
+const char* type_name(const DataType& type) {
+	switch (type) {
+		case DataType::VOID: return "void";
+		case DataType::BOOL: return "bool";
+		case DataType::CHAR: return "char";
+		case DataType::INT: return "int";
+		case DataType::DOUBLE: return "double";
+		case DataType::STRING: return "string";
+		default: return "unknown";
+	}
+}
+
+
+DataType parse_type(const string_view& name) {
+	for (auto type : {DataType::VOID, DataType::BOOL, DataType::CHAR, DataType::INT, DataType::DOUBLE, DataType::STRING})
+		if (name == type_name(type))
+			return type;
+	return DataType::UNKNOWN;
+}
+
 
 Node::Node(const NodeType& type) : type(type) {}
 
@@ -16,7 +72,7 @@ FuncDeclaration::FuncDeclaration(const FuncType& type)
 
 
 
-FuncProt::FuncProt(const string& return_type, const string& func_name, vector<unique_ptr<VarDeclaration>>&& args)
+FuncProt::FuncProt(const string_view& return_type, const Symbol& func_name, node_list<VarDeclaration>&& args)
 	: FuncDeclaration(FuncDeclaration::PROT),
 	  return_type(return_type),
 	  func_name(func_name),
@@ -27,8 +83,12 @@ void FuncProt::accept(ConstVisitor& v) {
 	v.visit(*this);
 }
 
+void FuncProt::accept(Visitor& v) {
+	v.visit(*this);
+}
+
 
-FuncDef::FuncDef(unique_ptr<FuncProt>&& prot, unique_ptr<Block>&& block)
+FuncDef::FuncDef(node_ptr<FuncProt>&& prot, node_ptr<Block>&& block)
 	: FuncDeclaration(FuncDeclaration::DEF),
 	  prot(move(prot)),
 	  block(move(block)) {}
@@ -37,6 +97,10 @@ void FuncDef::accept(ConstVisitor& v) {
 	v.visit(*this);
 }
 
+void FuncDef::accept(Visitor& v) {
+	v.visit(*this);
+}
+
 
 
 Statement::Statement(const NodeType& type) : Node(type) {}
@@ -45,7 +109,7 @@ Statement::~Statement() {}
 
 
 
-Block::Block(vector<unique_ptr<Statement>>&& statements, const int& level)
+Block::Block(node_list<Statement>&& statements, const int& level)
 	: Statement(Statement::BLOCK),
 	  statements(move(statements)),
 	  level(level) {}
@@ -55,9 +119,13 @@ void Block::accept(ConstVisitor& v) {
 	v.visit(*this);
 }
 
+void Block::accept(Visitor& v) {
+	v.visit(*this);
+}
+
 
 
-VarDeclaration::VarDeclaration(const string& datatype, const string& name, unique_ptr<Expr>&& value)
+VarDeclaration::VarDeclaration(const string_view& datatype, const Symbol& name, node_ptr<Expr>&& value)
     : Declaration(Declaration::VARDECL),
 	  Statement(Statement::VARDECL),
 	  datatype(datatype), 
@@ -65,7 +133,7 @@ VarDeclaration::VarDeclaration(const string& datatype, const string& name, uniqu
 	  value(move(value)) {}
 
 
-VarDeclaration::VarDeclaration(const string& datatype, const string& name)
+VarDeclaration::VarDeclaration(const string_view& datatype, const Symbol& name)
     : Declaration(Declaration::VARDECL),
 	  Statement(Statement::VARDECL),
 	  datatype(datatype), 
@@ -76,64 +144,184 @@ void VarDeclaration::accept(ConstVisitor& v) {
 	v.visit(*this);
 }
 
+void VarDeclaration::accept(Visitor& v) {
+	v.visit(*this);
+}
 
-const unordered_map<string, function<double(const double&)>> Expr::unary_op_dict = {
-	{"+", [](const double& x) { return x; }},
-	{"-", [](const double& x) { return -x; }}
-};
 
-const unordered_map<string, function<double(const double&, const double&)>> Expr::binary_op_dict = {
-	{"+", [](const double& x, const double& y) { return x + y; }},
-	{"-", [](const double& x, const double& y) { return x - y; }},
-	{"*", [](const double& x, const double& y) { return x * y; }},
-	{"/", [](const double& x, const double& y) { return x / y; }},
-	{"**", [](const double& x, const double& y) { return pow(x, y); }}
-};
+Expr::Expr(const ExprType& type, const string_view& value, node_list<Expr>&& branches)
+	: Statement(Statement::EXPRESSION),
+	  type(type),
+	  op(resolve(type, value)),
+	  symbol(SymbolTable::none),
+	  value(value),
+	  branches(move(branches)) {}
 
-const unordered_map<string, function<double(const vector<double>&)>> Expr::math_function_dict = {
-	{"pow", [](const vector<double>& args) { return pow(args[0], args[1]); }},
-	{"exp", [](const vector<double>& args) { return exp(args[0]); }},
-	{"log", [](const vector<double>& args) { return log(args[0]); }},
-	{"sin", [](const vector<double>& args) { return sin(args[0]); }},
-	{"cos", [](const vector<double>& args) { return cos(args[0]); }}
-};
 
+Expr::Expr(const ExprType& type, const string_view& value)
+	: Statement(Statement::EXPRESSION),
+	  type(type),
+	  op(resolve(type, value)),
+	  symbol(SymbolTable::none),
+	  value(value) {
+	if (type != CONST)
+		return;
+	from_chars(value.data(), value.data() + value.size(), number);
+	if (is_integer()) {
+		bool negative = value[0] == '-';
+		uint64_t magnitude;
+		auto [end, error] = from_chars(value.data() + negative, value.data() + value.size(), magnitude);
+		integer = error == errc() ? int64_t(negative ? 0 - magnitude : magnitude) : int64_t(convert(number, DataType::INT));
+	}
+}
 
-Expr::Expr(const ExprType& type, const string& value, vector<unique_ptr<Expr>>&& branches)
+
+Expr::Expr(const ExprType& type, const Symbol& symbol, node_list<Expr>&& branches)
 	: Statement(Statement::EXPRESSION),
 	  type(type),
-	  value(value),
+	  symbol(symbol),
 	  branches(move(branches)) {}
 
 
-Expr::Expr(const ExprType& type, const string& value)
+Expr::Expr(const ExprType& type, const Symbol& symbol)
 	: Statement(Statement::EXPRESSION),
 	  type(type),
-	  value(value) {}
+	  symbol(symbol) {}
+
+
+Expr::Operator Expr::resolve(const ExprType& type, const string_view& text) {
+	struct Entry { string_view text; Operator op; };
+	static constexpr Entry operators[] = {
+		{"+", ADD}, {"-", SUB}, {"*", MUL}, {"/", DIV}, {"%", MOD}, {"**", POW},
+		{"==", EQ}, {"!=", NE}, {"<", LT}, {"<=", LE}, {">", GT}, {">=", GE},
+		{"&&", AND}, {"||", OR}, {"!", NOT},
+		{"=", ASSIGN}, {"++", INCREMENT}, {"--", DECREMENT}
+	};
+	static constexpr Entry functions[] = {
+		{"pow", POW}, {"sin", SIN}, {"cos", COS}, {"exp", EXP}, {"log", LOG},
+		{"print", PRINT}, {"read", READ}, {"abs", ABS}, {"sgn", SGN}
+	};
+
+	if (type == BINARY_OP || type == PRE_UNARY_OP || type == POST_UNARY_OP) {
+		for (const auto& it : operators)
+			if (it.text == text)
+				return it.op;
+	} else if (type == MATH_FUNC || type == BUILTIN_FUNC) {
+		for (const auto& it : functions)
+			if (it.text == text)
+				return it.op;
+	}
+	return NONE;
+}
 
 
-double Expr::eval(const double& x) {
+// One switch per node with the arithmetic inline: no lookups and no allocation.
+double Expr::eval(const double& x) const {
 	switch (type) {
 		case CONST:
-			return stod(value);
+			return number;
+		case CHAR:
+			return value.empty() ? 0 : value[0];
 		case VAR:
 			return x;
-		case PRE_UNARY_OP:
-		case POST_UNARY_OP:
-			return unary_op_dict.at(value)(branches[0]->eval(x));
-		case BINARY_OP:
-			return binary_op_dict.at(value)(branches[0]->eval(x), branches[1]->eval(x));
-		case BUILTIN_FUNC: // встроенные функции print, scan, abs, sgn
-			return stod(value);
-		case FUNC: // пользовательские функции
-			return stod(value);
-		case MATH_FUNC: // мат функции sin, cos, log, exp, pow
-			vector<double> args;
-			for (const auto& it : branches)
-				args.push_back(it->eval(x));
-			return math_function_dict.at(value)(args);
+		case PRE_UNARY_OP: {
+			double a = branches[0]->eval(x);
+			switch (op) {
+				case ADD: return a;
+				case SUB: return -a;
+				case NOT: return a == 0;
+				default: break;
+			}
+			break;
+		}
+		case BINARY_OP: {
+			double a = branches[0]->eval(x), b = branches[1]->eval(x);
+			switch (op) {
+				case ADD: return a + b;
+				case SUB: return a - b;
+				case MUL: return a * b;
+				case DIV:
+				case MOD:
+					if (!is_integral_type(value_type))
+						return op == DIV ? a / b : fmod(a, b);
+					if (b == 0)
+						throw runtime_error("Expr::eval(): Integer division by zero");
+					return op == DIV ? trunc(a / b) : fmod(a, b);
+				case POW: return pow(a, b);
+				case EQ: return a == b;
+				case NE: return a != b;
+				case LT: return a < b;
+				case LE: return a <= b;
+				case GT: return a > b;
+				case GE: return a >= b;
+				case AND: return a != 0 && b != 0;
+				case OR: return a != 0 || b != 0;
+				default: break;
+			}
+			break;
+		}
+		case MATH_FUNC:
+		case BUILTIN_FUNC: {
+			if (branches.size() != (op == POW ? 2u : 1u))
+				break;
+			double a = branches[0]->eval(x);
+			switch (op) {
+				case POW: return pow(a, branches[1]->eval(x));
+				case SIN: return sin(a);
+				case COS: return cos(a);
+				case EXP: return exp(a);
+				case LOG: return log(a);
+				case ABS: return fabs(a);
+				case SGN: return (a > 0) - (a < 0);
+				default: break;
+			}
+			break;
+		}
+		case CAST:
+			return convert(branches[0]->eval(x), value_type);
+		default:
+			break;
 	}
-	return 0.0;
+	throw runtime_error("Expr::eval(): Cannot evaluate " + string(value));
+}
+
+
+double Expr::convert(const double& value, const DataType& type) {
+	switch (type) {
+		case DataType::BOOL:
+			return value != 0;
+		case DataType::CHAR:
+		case DataType::INT: {
+			// out of range and NaN give INT64_MIN, as x86-64's cvttsd2si does
+			auto integer = value >= -0x1p63 && value < 0x1p63 ? int64_t(value) : INT64_MIN;
+			return type == DataType::CHAR ? int8_t(integer) : double(integer);
+		}
+		default:
+			return value;
+	}
+}
+
+
+int64_t Expr::convert_integer(const int64_t& value, const DataType& type) {
+	switch (type) {
+		case DataType::BOOL:
+			return value != 0;
+		case DataType::CHAR:
+			return int8_t(value);
+		default:
+			return value;
+	}
+}
+
+
+bool Expr::is_comparison() const {
+	return op >= EQ && op <= GE;
+}
+
+
+bool Expr::is_integer() const {
+	auto digits = value.substr(!value.empty() && value[0] == '-');
+	return type == CONST && !digits.empty() && all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; });
 }
 
 
@@ -141,15 +329,19 @@ void Expr::accept(ConstVisitor& v) {
 	v.visit(*this);
 }
 
+void Expr::accept(Visitor& v) {
+	v.visit(*this);
+}
+
 
-Conditional::Conditional(const ConditionType& type, unique_ptr<Expr>&& condition, unique_ptr<Block>&& block)
+Conditional::Conditional(const ConditionType& type, node_ptr<Expr>&& condition, node_ptr<Block>&& block)
 	: Statement(Statement::CONDITIONAL),
 	  type(type),
 	  condition(move(condition)),
 	  block(move(block)) {}
 
 
-Conditional::Conditional(const ConditionType& type, unique_ptr<Block>&& block)
+Conditional::Conditional(const ConditionType& type, node_ptr<Block>&& block)
 	: Statement(Statement::CONDITIONAL),
 	  type(type),
 	  block(move(block)) {}
@@ -159,8 +351,12 @@ void Conditional::accept(ConstVisitor& v) {
 	v.visit(*this);
 }
 
+void Conditional::accept(Visitor& v) {
+	v.visit(*this);
+}
+
 
-Loop::Loop(unique_ptr<Expr>&& condition, unique_ptr<Block>&& block)
+Loop::Loop(node_ptr<Expr>&& condition, node_ptr<Block>&& block)
 	: Statement(Statement::LOOP),
 	  condition(move(condition)),
 	  block(move(block)) {}
@@ -170,15 +366,23 @@ void Loop::accept(ConstVisitor& v) {
 	v.visit(*this);
 }
 
+void Loop::accept(Visitor& v) {
+	v.visit(*this);
+}
+
 
 
-Return::Return(unique_ptr<Expr>&& ret) : Statement(Statement::RETURN), ret_expr(move(ret)) {}
+Return::Return(node_ptr<Expr>&& ret) : Statement(Statement::RETURN), ret_expr(move(ret)) {}
 
 
 void Return::accept(ConstVisitor& v) {
 	v.visit(*this);
 }
 
+void Return::accept(Visitor& v) {
+	v.visit(*this);
+}
+
 
 
 Jump::Jump(const JumpType& type) : Statement(Statement::JUMP), type(type) {}
@@ -188,7 +392,15 @@ void Jump::accept(ConstVisitor& v) {
 	v.visit(*this);
 }
 
+void Jump::accept(Visitor& v) {
+	v.visit(*this);
+}
+
 void AST::accept(ConstVisitor& v) {
 	v.visit(*this);
 }
 
+void AST::accept(Visitor& v) {
+	v.visit(*this);
+}
+
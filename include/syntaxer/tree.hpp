@@ -3,25 +3,89 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <span>
 #include <functional>
 #include <unordered_map>
 #include <cmath>
 #include <algorithm>
 #include <memory>
+#include <memory_resource>
+#include <cstdint>
+#include <deque>
+#include "../lexer/symbols.hpp"
+#include "arena.hpp"
 
 
 using namespace std;
 
 
+// Literal text in the tree is a view into the lexed source buffer, which has
+// to outlive the AST. Names are symbols of AST::symbols.
+
 class ConstVisitor;
+class Visitor;
+class Node;
 class VarDeclaration;
 class Block;
 class Expr;
 
 
+// Owning pointer to a node that is either heap allocated or lives in an Arena;
+// arena nodes are never destroyed individually.
+struct NodeDeleter {
+	void operator()(Node*) const;
+	void operator()(VarDeclaration*) const;
+};
+
+template<class T> using node_ptr = unique_ptr<T, NodeDeleter>;
+template<class T> using node_list = pmr::vector<node_ptr<T>>;
+
+void mark_in_arena(Node*);
+void mark_in_arena(VarDeclaration*);
+void set_offset(Node*, const uint32_t&);
+void set_offset(VarDeclaration*, const uint32_t&);
+
+// Allocates a node on the heap, or in the arena when one is given.
+template<class T, class... Args>
+node_ptr<T> make_node(Arena* arena, Args&&... args) {
+	if (!arena)
+		return node_ptr<T>(new T(forward<Args>(args)...));
+	T* node = new (arena->allocate(sizeof(T), alignof(T))) T(forward<Args>(args)...);
+	mark_in_arena(node);
+	return node_ptr<T>(node);
+}
+
+template<class T>
+node_list<T> make_list(Arena* arena) {
+	return node_list<T>(arena ? static_cast<pmr::memory_resource*>(arena) : pmr::new_delete_resource());
+}
+
+
+// Frame location of a variable, filled in by Resolver: depth 0 is a global slot,
+// depth 1 a function parameter and deeper levels variables of nested blocks.
+// Slots are numbered per function and reused by sibling blocks.
+struct Binding {
+	static constexpr uint16_t unresolved = UINT16_MAX;
+	uint16_t depth = unresolved;
+	uint16_t slot = 0;
+};
+
+
+// Static type of a value, filled in by TypeChecker. char and bool are kept as
+// integers, so converting them to int never changes the representation.
+enum class DataType : uint8_t { UNKNOWN, VOID, BOOL, CHAR, INT, DOUBLE, STRING };
+
+const char* type_name(const DataType&);
+DataType parse_type(const string_view&); // UNKNOWN for names that are not types
+inline bool is_integral_type(const DataType& type) {
+	return type == DataType::BOOL || type == DataType::CHAR || type == DataType::INT;
+}
+
+
 class Node {
 public:
-	enum NodeType {
+	enum NodeType : uint8_t {
 		STRING,
 		VARDECL,
 		FUNCDECL,
@@ -33,11 +97,18 @@ public:
 		JUMP
 	};
 
+	static constexpr uint32_t no_offset = UINT32_MAX;
+
 	NodeType type;
+	bool in_arena = false;
+	// Source offset of the node's first token, set by the Syntaxer for
+	// declarations and statements; SourceMap turns it into a line and column.
+	uint32_t offset = no_offset;
 	Node(const NodeType&);
 	virtual ~Node();
 
 	virtual void accept(ConstVisitor&) = 0;
+	virtual void accept(Visitor&) = 0;
 };
 
 
@@ -62,22 +133,25 @@ public:
 
 class FuncProt : public FuncDeclaration {
 public:
-	string return_type;
-	string func_name;
-	vector<unique_ptr<VarDeclaration>> args;
+	string_view return_type;
+	Symbol func_name;
+	node_list<VarDeclaration> args;
 
-	FuncProt(const string&, const string&, vector<unique_ptr<VarDeclaration>>&&);
+	FuncProt(const string_view&, const Symbol&, node_list<VarDeclaration>&&);
 	virtual void accept(ConstVisitor&) override;
+	virtual void accept(Visitor&) override;
 };
 
 
 class FuncDef : public FuncDeclaration {
 public:
-	unique_ptr<FuncProt> prot;
-	unique_ptr<Block> block;
+	node_ptr<FuncProt> prot;
+	node_ptr<Block> block;
+	uint16_t frame_size = 0; // variable slots, set by Resolver
 
-	FuncDef(unique_ptr<FuncProt>&&, unique_ptr<Block>&&);
+	FuncDef(node_ptr<FuncProt>&&, node_ptr<Block>&&);
 	virtual void accept(ConstVisitor&) override;
+	virtual void accept(Visitor&) override;
 };
 
 
@@ -94,31 +168,34 @@ class Block : public Statement {
 public:
 	int level;
 
-	vector<unique_ptr<Statement>> statements;
-	Block(vector<unique_ptr<Statement>>&&, const int&);
+	node_list<Statement> statements;
+	Block(node_list<Statement>&&, const int&);
 	
 	virtual void accept(ConstVisitor&) override;
+	virtual void accept(Visitor&) override;
 };
 
 
 
 class VarDeclaration : public Declaration, public Statement {
 public:
-	string datatype;
-	string var_name;
-	unique_ptr<Expr> value;
+	string_view datatype;
+	Symbol var_name;
+	node_ptr<Expr> value;
+	Binding binding;
 
-	VarDeclaration(const string&, const string&, unique_ptr<Expr>&&);
-	VarDeclaration(const string&, const string&);
+	VarDeclaration(const string_view&, const Symbol&, node_ptr<Expr>&&);
+	VarDeclaration(const string_view&, const Symbol&);
 	
 	virtual void accept(ConstVisitor&) override;
+	virtual void accept(Visitor&) override;
 };
 
 
 
 class Expr : public Statement {
 public:
-	enum ExprType {
+	enum ExprType : uint8_t {
 		CONST,
 		STRING,
 		CHAR,
@@ -128,24 +205,53 @@ public:
 		MATH_FUNC,
 		BINARY_OP,
 		PRE_UNARY_OP,
-		POST_UNARY_OP
+		POST_UNARY_OP,
+		CAST // conversion of branches[0] to value_type, inserted by TypeChecker
 	};
 
-	ExprType type;
-	string value;
-	vector<unique_ptr<Expr>> branches;
-
-	Expr(const ExprType&, const string&, vector<unique_ptr<Expr>>&&);
-	Expr(const ExprType&, const string&);
+	// Resolved from the text when the node is built; unary + and - are ADD and SUB,
+	// and POW is both ** and pow().
+	enum Operator : uint8_t {
+		NONE,
+		ADD, SUB, MUL, DIV, MOD, POW,
+		EQ, NE, LT, LE, GT, GE,
+		AND, OR, NOT,
+		ASSIGN, INCREMENT, DECREMENT,
+		SIN, COS, EXP, LOG,
+		PRINT, READ, ABS, SGN
+	};
 
-	double eval(const double& x = 0);
+	ExprType type;
+	Operator op = NONE;
+	Symbol symbol; // VAR and FUNC name, SymbolTable::none otherwise
+	Binding binding; // VAR only
+	string_view value; // literal or operator text, function name for BUILTIN_FUNC and MATH_FUNC
+	double number = 0; // CONST only, parsed once from value
+	int64_t integer = 0; // exact value of an integer CONST (is_integer()), wrapped to 64 bits
+	DataType value_type = DataType::UNKNOWN;
+	node_list<Expr> branches;
+
+	Expr(const ExprType&, const string_view&, node_list<Expr>&&);
+	Expr(const ExprType&, const string_view&);
+	Expr(const ExprType&, const Symbol&, node_list<Expr>&&);
+	Expr(const ExprType&, const Symbol&);
+
+	// Values are doubles; a typed tree divides int operands with truncation.
+	double eval(const double& x = 0) const;
+	// eval() at every xs[i] into out[i]; walks the tree once per block of inputs
+	// with SIMD kernels (batch.cpp). Math functions may differ from libm by a few ulp.
+	void eval_batch(span<const double> xs, span<double> out) const;
+	// CONST written as an integer: digits with an optional leading minus
+	bool is_integer() const;
+	// value converted as a CAST to `type` converts it
+	static double convert(const double& value, const DataType& type);
+	// an integral value converted to an integral `type`
+	static int64_t convert_integer(const int64_t& value, const DataType& type);
+	bool is_comparison() const;
+	static Operator resolve(const ExprType&, const string_view&);
 	
 	virtual void accept(ConstVisitor&) override;
-
-private:
-	static const unordered_map<string, function<double(const double&)>> unary_op_dict;
-	static const unordered_map<string, function<double(const double&, const double&)>> binary_op_dict;
-	static const unordered_map<string, function<double(const vector<double>&)>> math_function_dict;
+	virtual void accept(Visitor&) override;
 };
 
 
@@ -155,36 +261,39 @@ public:
 	enum ConditionType { IF, ELIF, ELSE };
 
 	ConditionType type;
-	unique_ptr<Expr> condition;
-	unique_ptr<Block> block;
+	node_ptr<Expr> condition;
+	node_ptr<Block> block;
 
-	Conditional(const ConditionType&, unique_ptr<Expr>&&, unique_ptr<Block>&&);
-	Conditional(const ConditionType&, unique_ptr<Block>&&);
+	Conditional(const ConditionType&, node_ptr<Expr>&&, node_ptr<Block>&&);
+	Conditional(const ConditionType&, node_ptr<Block>&&);
 
 	virtual void accept(ConstVisitor&) override;
+	virtual void accept(Visitor&) override;
 };
 
 
 
 class Loop : public Statement {
 public:
-	unique_ptr<Expr> condition;
-	unique_ptr<Block> block;
+	node_ptr<Expr> condition;
+	node_ptr<Block> block;
 
-	Loop(unique_ptr<Expr>&&, unique_ptr<Block>&&);
+	Loop(node_ptr<Expr>&&, node_ptr<Block>&&);
 
 	virtual void accept(ConstVisitor&) override;
+	virtual void accept(Visitor&) override;
 };
 
 
 
 class Return : public Statement {
 public:
-	unique_ptr<Expr> ret_expr;
+	node_ptr<Expr> ret_expr;
 
-	Return(unique_ptr<Expr>&&);
+	Return(node_ptr<Expr>&&);
 
 	virtual void accept(ConstVisitor&) override;
+	virtual void accept(Visitor&) override;
 };
 
 
@@ -197,12 +306,18 @@ public:
 	Jump(const JumpType&);
 
 	virtual void accept(ConstVisitor&) override;
+	virtual void accept(Visitor&) override;
 };
 
 class AST {
 public:
-	vector<unique_ptr<Declaration>> declarations;
+	shared_ptr<Arena> arena; // declared first: released after the nodes it holds
+	vector<shared_ptr<Arena>> worker_arenas; // nodes of a parallel parse, one arena per worker
+	vector<node_ptr<Declaration>> declarations;
+	shared_ptr<SymbolTable> symbols;
+	deque<string> texts; // text of nodes created by passes, viewed by their string_view fields
 
 	void accept(ConstVisitor&);
+	void accept(Visitor&);
 };
 
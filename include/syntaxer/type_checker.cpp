@@ -0,0 +1,327 @@
+#include "type_checker.hpp"
+#include "resolver.hpp"
+#include <cstring>
+
+
+void TypeChecker::check(AST& ast) {
+    TypeChecker checker;
+    checker.visit(ast);
+}
+
+
+DataType TypeChecker::declared(const string_view& name) {
+    auto type = parse_type(name);
+    if (type == DataType::UNKNOWN)
+        throw runtime_error("TypeChecker: Unknown type " + string(name));
+    return type;
+}
+
+
+bool TypeChecker::numeric(const DataType& type) {
+    return is_integral_type(type) || type == DataType::DOUBLE;
+}
+
+
+// char and bool operands are computed as int, as in C
+DataType TypeChecker::promote(const DataType& type) {
+    return type == DataType::DOUBLE ? DataType::DOUBLE : DataType::INT;
+}
+
+
+DataType& TypeChecker::variable(const Binding& binding) {
+    auto& types = binding.depth == 0 ? global_types : local_types;
+    if (types.size() <= binding.slot)
+        types.resize(binding.slot + 1, DataType::UNKNOWN);
+    return types[binding.slot];
+}
+
+
+void TypeChecker::declare(const VarDeclaration& var) {
+    variable(var.binding) = declared(var.datatype);
+}
+
+
+// Infers the operand's type and checks that it is a number; `user` names the
+// expression in the error.
+DataType TypeChecker::operand(node_ptr<Expr>& slot, const Expr& user) {
+    auto type = infer(*slot);
+    if (!numeric(type))
+        throw runtime_error(string("TypeChecker: Operand of ") + (user.value.empty() ? "expression" : string(user.value)) +
+                            " has type " + type_name(type) + ", expected a number");
+    return type;
+}
+
+
+// Converts an inferred operand to `target`: integer and character literals are
+// retyped in place, anything else is wrapped in a CAST.
+void TypeChecker::require(node_ptr<Expr>& slot, const DataType& target) {
+    auto from = slot->value_type;
+    if (from == target)
+        return;
+    if (!numeric(from) || !numeric(target))
+        throw runtime_error(string("TypeChecker: Cannot convert ") + type_name(from) + " to " + type_name(target));
+
+    bool literal = (slot->type == Expr::CONST && from == DataType::INT) || slot->type == Expr::CHAR;
+    bool exact = target == DataType::DOUBLE || target == DataType::INT ||
+                 (target == DataType::CHAR && slot->type == Expr::CONST && slot->number >= INT8_MIN && slot->number <= INT8_MAX) ||
+                 (target == DataType::BOOL && slot->type == Expr::CONST && (slot->number == 0 || slot->number == 1));
+    if (literal && exact) {
+        slot->value_type = target;
+        return;
+    }
+
+    auto branches = make_list<Expr>(ast->arena.get());
+    branches.push_back(move(slot));
+    slot = make_node<Expr>(ast->arena.get(), Expr::CAST, string_view(type_name(target)), move(branches));
+    slot->value_type = target;
+}
+
+
+DataType TypeChecker::infer(Expr& expr) {
+    auto& branches = expr.branches;
+    DataType type = DataType::UNKNOWN;
+    switch (expr.type) {
+        case Expr::CONST:
+            type = expr.is_integer() ? DataType::INT : DataType::DOUBLE;
+            break;
+        case Expr::CHAR:
+            type = DataType::CHAR;
+            break;
+        case Expr::STRING:
+            type = DataType::STRING;
+            break;
+        case Expr::VAR:
+            type = variable(expr.binding);
+            break;
+        case Expr::CAST:
+            operand(branches[0], expr);
+            type = expr.value_type;
+            break;
+        case Expr::FUNC:
+            type = call(expr);
+            break;
+        case Expr::BUILTIN_FUNC:
+            type = builtin(expr);
+            break;
+        case Expr::MATH_FUNC:
+            for (auto& it : branches) {
+                operand(it, expr);
+                require(it, DataType::DOUBLE);
+            }
+            type = DataType::DOUBLE;
+            break;
+        case Expr::PRE_UNARY_OP:
+        case Expr::POST_UNARY_OP:
+            type = operand(branches[0], expr);
+            if (expr.op == Expr::NOT) {
+                require(branches[0], DataType::BOOL);
+                type = DataType::BOOL;
+            } else if (expr.op == Expr::ADD || expr.op == Expr::SUB) {
+                type = promote(type);
+                require(branches[0], type);
+            }
+            break;
+        case Expr::BINARY_OP:
+            type = binary(expr);
+            break;
+    }
+    expr.value_type = type;
+    return type;
+}
+
+
+DataType TypeChecker::binary(Expr& expr) {
+    auto& left = expr.branches[0];
+    auto& right = expr.branches[1];
+    if (expr.op == Expr::ASSIGN) {
+        auto type = infer(*left);
+        infer(*right);
+        if (numeric(type))
+            require(right, type);
+        return type;
+    }
+
+    auto left_type = operand(left, expr), right_type = operand(right, expr);
+    DataType common = promote(left_type) == DataType::DOUBLE || right_type == DataType::DOUBLE ? DataType::DOUBLE : DataType::INT;
+    if (expr.op == Expr::AND || expr.op == Expr::OR)
+        common = DataType::BOOL;
+    else if (expr.op == Expr::POW)
+        common = DataType::DOUBLE;
+    require(left, common);
+    require(right, common);
+    return expr.is_comparison() ? DataType::BOOL : common;
+}
+
+
+DataType TypeChecker::call(Expr& expr) {
+    auto found = functions.find(expr.symbol);
+    if (found == functions.end()) {
+        if (ast->symbols->name(expr.symbol) == "printf") {
+            printf_args(expr);
+            return DataType::INT;
+        }
+        for (auto& it : expr.branches)
+            infer(*it);
+        return DataType::INT; // reported as undeclared by the compiler
+    }
+
+    const auto& signature = found->second;
+    for (size_t i = 0; i < expr.branches.size(); i++) {
+        auto type = infer(*expr.branches[i]);
+        if (i < signature.args.size() && numeric(signature.args[i]) && type != DataType::STRING)
+            require(expr.branches[i], signature.args[i]);
+    }
+    return signature.return_type;
+}
+
+
+// printf arguments are converted to what their conversion reads: int for
+// d i u x X o c and double for f F e E g G a A.
+void TypeChecker::printf_args(Expr& expr) {
+    auto& args = expr.branches;
+    for (auto& it : args)
+        infer(*it);
+    if (args.empty() || args[0]->type != Expr::STRING)
+        return;
+
+    auto format = args[0]->value;
+    size_t next = 1;
+    for (size_t i = 0; i < format.size() && next < args.size(); i++) {
+        if (format[i] != '%')
+            continue;
+        if (i + 1 < format.size() && format[i + 1] == '%') {
+            i++;
+            continue;
+        }
+        i++;
+        while (i < format.size() && (strchr("-+ #0.hlLqjzt", format[i]) || isdigit(static_cast<unsigned char>(format[i]))))
+            i++;
+        if (i == format.size())
+            break;
+        if (strchr("diuxXoc", format[i]) && numeric(args[next]->value_type))
+            require(args[next], DataType::INT);
+        else if (strchr("fFeEgGaA", format[i]) && numeric(args[next]->value_type))
+            require(args[next], DataType::DOUBLE);
+        else
+            continue; // not a conversion the VM knows; printed as written
+        next++;
+    }
+}
+
+
+DataType TypeChecker::builtin(Expr& expr) {
+    auto& args = expr.branches;
+    switch (expr.op) {
+        case Expr::PRINT:
+            for (auto& it : args)
+                if (it->type != Expr::STRING)
+                    operand(it, expr);
+            return DataType::VOID;
+        case Expr::READ:
+            for (auto& it : args)
+                infer(*it);
+            return DataType::DOUBLE;
+        case Expr::ABS:
+        case Expr::SGN: {
+            if (args.size() != 1)
+                return expr.op == Expr::ABS ? DataType::DOUBLE : DataType::INT; // arity is reported by the compiler
+            auto type = promote(operand(args[0], expr));
+            require(args[0], type);
+            return expr.op == Expr::ABS ? type : DataType::INT;
+        }
+        default:
+            return DataType::VOID;
+    }
+}
+
+
+void TypeChecker::visit(AST& root) {
+    Resolver::resolve(root);
+    ast = &root;
+    // calls may precede the definition
+    for (auto& it : root.declarations) {
+        if (it->type != Node::FUNCDECL)
+            continue;
+        auto declaration = static_cast<const FuncDeclaration*>(it.get());
+        auto prot = declaration->type == FuncDeclaration::DEF ? static_cast<const FuncDef*>(declaration)->prot.get()
+                                                              : static_cast<const FuncProt*>(declaration);
+        Signature signature{declared(prot->return_type), {}};
+        for (auto& arg : prot->args)
+            signature.args.push_back(declared(arg->datatype));
+        functions.try_emplace(prot->func_name, move(signature));
+    }
+    for (auto& it : root.declarations)
+        it->accept(*this);
+}
+
+
+void TypeChecker::visit(VarDeclaration& var) {
+    auto type = declared(var.datatype);
+    if (var.value) {
+        infer(*var.value);
+        if (numeric(type))
+            require(var.value, type);
+    }
+    declare(var);
+}
+
+
+void TypeChecker::visit(FuncProt& prot) {
+    for (auto& arg : prot.args) {
+        auto type = declared(arg->datatype);
+        if (arg->value) {
+            infer(*arg->value);
+            if (numeric(type))
+                require(arg->value, type);
+        }
+    }
+}
+
+
+void TypeChecker::visit(FuncDef& def) {
+    def.prot->accept(*this);
+    local_types.assign(def.frame_size, DataType::UNKNOWN);
+    for (auto& arg : def.prot->args)
+        declare(*arg);
+    return_type = declared(def.prot->return_type);
+    def.block->accept(*this);
+}
+
+
+void TypeChecker::visit(Block& block) {
+    for (auto& it : block.statements)
+        it->accept(*this);
+}
+
+
+void TypeChecker::visit(Expr& expr) {
+    infer(expr);
+}
+
+
+void TypeChecker::visit(Conditional& cond) {
+    if (cond.condition) {
+        operand(cond.condition, *cond.condition);
+        require(cond.condition, DataType::BOOL);
+    }
+    cond.block->accept(*this);
+}
+
+
+void TypeChecker::visit(Loop& loop) {
+    operand(loop.condition, *loop.condition);
+    require(loop.condition, DataType::BOOL);
+    loop.block->accept(*this);
+}
+
+
+void TypeChecker::visit(Return& ret) {
+    if (!ret.ret_expr)
+        return;
+    infer(*ret.ret_expr);
+    if (numeric(return_type))
+        require(ret.ret_expr, return_type);
+}
+
+
+void TypeChecker::visit(Jump&) {}
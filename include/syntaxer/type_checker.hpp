@@ -0,0 +1,56 @@
+#pragma once
+
+
+#include <unordered_map>
+#include "tree.hpp"
+#include "../visitor.hpp"
+
+
+// Gives every Expr its static type (Expr::value_type) and makes conversions
+// explicit: operands of arithmetic and comparisons are brought to a common
+// type (int unless either side is double), conditions and logical operands to
+// bool, and assigned values, arguments and returned values to the declared
+// type. A conversion is a CAST node around the operand; integer literals are
+// retyped in place instead. Runs the Resolver first and can be repeated.
+class TypeChecker : public Visitor {
+public:
+    static void check(AST&);
+
+private:
+    struct Signature {
+        DataType return_type;
+        vector<DataType> args;
+    };
+
+    AST* ast = nullptr;
+    unordered_map<Symbol, Signature> functions;
+    vector<DataType> global_types; // by global slot
+    vector<DataType> local_types; // by frame slot of the current function
+    DataType return_type = DataType::VOID;
+
+    static DataType declared(const string_view&);
+    static bool numeric(const DataType&);
+    static DataType promote(const DataType&);
+    DataType& variable(const Binding&);
+    void declare(const VarDeclaration&);
+
+    DataType infer(Expr&);
+    DataType operand(node_ptr<Expr>&, const Expr&);
+    void require(node_ptr<Expr>&, const DataType&);
+    DataType binary(Expr&);
+    DataType call(Expr&);
+    DataType builtin(Expr&);
+    void printf_args(Expr&);
+
+public:
+    virtual void visit(AST&) override;
+    virtual void visit(VarDeclaration&) override;
+    virtual void visit(FuncProt&) override;
+    virtual void visit(FuncDef&) override;
+    virtual void visit(Block&) override;
+    virtual void visit(Expr&) override;
+    virtual void visit(Conditional&) override;
+    virtual void visit(Loop&) override;
+    virtual void visit(Return&) override;
+    virtual void visit(Jump&) override;
+};
@@ -2,15 +2,18 @@
 
 
 const int Printer::tab_size = 4;
-int Printer::level = 0;
+
+
+Printer::Printer(ostream& out) : out(out) {}
 
 
 void Printer::print_tabs(const int& N) const {
-	cout << string(N * tab_size, ' ');
+	out << string(N * tab_size, ' ');
 }
 
 
 void Printer::visit(const AST& root) {
+	symbols = root.symbols.get();
 	for (auto& it : root.declarations)
 		it->accept(*this);
 }
@@ -18,36 +21,36 @@ void Printer::visit(const AST& root) {
 
 void Printer::visit(const VarDeclaration& var) {
 	if (var.value) {
-		cout << var.datatype << " " << var.var_name << " = ";
+		out << var.datatype << " " << symbols->name(var.var_name) << " = ";
 		var.value->accept(*this);
 	} else
-		cout << var.datatype << " " << var.var_name;
+		out << var.datatype << " " << symbols->name(var.var_name);
 	if (level == 0)
-		cout << ";" << endl;
+		out << ";" << endl;
 }
 
 
 void Printer::visit(const FuncProt& prot) {
-	cout << prot.return_type << " " << prot.func_name << "(";
+	out << prot.return_type << " " << symbols->name(prot.func_name) << "(";
 	for (size_t i = 0, size = prot.args.size(); i < size; i++) {
-		cout << prot.args[i]->datatype << " " << prot.args[i]->var_name;
+		out << prot.args[i]->datatype << " " << symbols->name(prot.args[i]->var_name);
 		if (prot.args[i]->value) {
-			cout << " = ";
+			out << " = ";
 			prot.args[i]->value->accept(*this);
 		}
 		if (i != size - 1)
-			cout << ", ";
+			out << ", ";
 	}
-	cout << ")";
+	out << ")";
 }
 
 
 void Printer::visit(const FuncDef& def) {
     def.prot->accept(*this);
-	cout << " {" << endl;
+	out << " {" << endl;
 	def.block->accept(*this);
-	cout << "}" << endl;
-	cout << endl;
+	out << "}" << endl;
+	out << endl;
 }
 
 
@@ -57,7 +60,7 @@ void Printer::visit(const Block& block) {
         print_tabs(block.level);
 		it->accept(*this);
 		if (it->type != Node::CONDITIONAL && it->type != Node::LOOP)
-			cout << ";" << endl;
+			out << ";" << endl;
     }
 }
 
@@ -65,41 +68,50 @@ void Printer::visit(const Block& block) {
 void Printer::visit(const Expr& expr) {
     switch (expr.type) {
 		case Expr::CONST:
+			out << expr.value;
+			break;
 		case Expr::VAR:
-			cout << expr.value;
+			out << symbols->name(expr.symbol);
 			break;
 		case Expr::CHAR:
-			cout << "\'" << expr.value << "\'";
+			out << "\'" << expr.value << "\'";
 			break;
 		case Expr::STRING:
-			cout << "\"" << expr.value << "\"";
+			out << "\"" << expr.value << "\"";
 			break;
 		case Expr::PRE_UNARY_OP:
-			cout << expr.value;
+			out << expr.value;
 			expr.branches[0]->accept(*this);
 			break;
 		case Expr::POST_UNARY_OP:
 			expr.branches[0]->accept(*this);
-			cout << expr.value;
+			out << expr.value;
+			break;
+		case Expr::CAST:
+			out << "(" << expr.value << ")";
+			expr.branches[0]->accept(*this);
 			break;
 		case Expr::BINARY_OP:
 			if (!expr.branches.empty()) {
 				expr.branches[0]->accept(*this);
-				cout << " " << expr.value << " ";
+				out << " " << expr.value << " ";
 				expr.branches[1]->accept(*this);
 			} else 
-				cout << expr.value;
+				out << expr.value;
 			break;
 		case Expr::FUNC:
 		case Expr::BUILTIN_FUNC:
 		case Expr::MATH_FUNC:
-			cout << expr.value << "(";
+			if (expr.type == Expr::FUNC)
+				out << symbols->name(expr.symbol) << "(";
+			else
+				out << expr.value << "(";
 			for (size_t i = 0, size = expr.branches.size(); i < size; i++) {
 				expr.branches[i]->accept(*this);
 				if (i != size - 1)
-					cout << ", ";
+					out << ", ";
 			}
-			cout << ")";
+			out << ")";
 			break;
 	}
 }
@@ -107,37 +119,269 @@ void Printer::visit(const Expr& expr) {
 
 void Printer::visit(const Conditional& ptr) {
     if (ptr.type == Conditional::IF || ptr.type == Conditional::ELIF) {
-		cout << (ptr.type == Conditional::IF ? "if (" : "elif (");
+		out << (ptr.type == Conditional::IF ? "if (" : "elif (");
 		ptr.condition->accept(*this);
-		cout << ") {" << endl;
+		out << ") {" << endl;
 		ptr.block->accept(*this);
 		print_tabs(ptr.block->level - 1);
-		cout << "}" << endl;
+		out << "}" << endl;
 	} else {
-		cout << "else {" << endl;
+		out << "else {" << endl;
 		ptr.block->accept(*this);
 		print_tabs(ptr.block->level - 1);
-		cout << "}" << endl;
+		out << "}" << endl;
 	}
 }
 
 
 void Printer::visit(const Loop& loop) {
-    cout << "while (";
+    out << "while (";
 	loop.condition->accept(*this);
-	cout << ") {" << endl;
+	out << ") {" << endl;
 	loop.block->accept(*this);
 	print_tabs(loop.block->level - 1);
-	cout << "}" << endl;
+	out << "}" << endl;
 }
 
 
 void Printer::visit(const Return& ret) {
-    cout << "return ";
+    out << "return ";
 	ret.ret_expr->accept(*this);
 }
 
 
 void Printer::visit(const Jump& jump) {
-	cout << (jump.type == Jump::BREAK ? "break" : "continue");
+	out << (jump.type == Jump::BREAK ? "break" : "continue");
+}
+
+
+
+size_t NodeCounter::total() const {
+	size_t sum = 0;
+	for (auto it : counts)
+		sum += it;
+	return sum;
+}
+
+
+void NodeCounter::visit(const AST& root) {
+	for (auto& it : root.declarations)
+		it->accept(*this);
+}
+
+
+void NodeCounter::visit(const VarDeclaration& var) {
+	counts[Node::VARDECL]++;
+	if (var.value)
+		var.value->accept(*this);
+}
+
+
+void NodeCounter::visit(const FuncProt& prot) {
+	counts[Node::FUNCDECL]++;
+	for (auto& it : prot.args)
+		it->accept(*this);
+}
+
+
+void NodeCounter::visit(const FuncDef& def) {
+	counts[Node::FUNCDECL]++;
+	def.prot->accept(*this);
+	def.block->accept(*this);
+}
+
+
+void NodeCounter::visit(const Block& block) {
+	counts[Node::BLOCK]++;
+	for (auto& it : block.statements)
+		it->accept(*this);
+}
+
+
+void NodeCounter::visit(const Expr& expr) {
+	counts[Node::EXPRESSION]++;
+	for (auto& it : expr.branches)
+		it->accept(*this);
+}
+
+
+void NodeCounter::visit(const Conditional& cond) {
+	counts[Node::CONDITIONAL]++;
+	if (cond.condition)
+		cond.condition->accept(*this);
+	cond.block->accept(*this);
+}
+
+
+void NodeCounter::visit(const Loop& loop) {
+	counts[Node::LOOP]++;
+	loop.condition->accept(*this);
+	loop.block->accept(*this);
+}
+
+
+void NodeCounter::visit(const Return& ret) {
+	counts[Node::RETURN]++;
+	ret.ret_expr->accept(*this);
+}
+
+
+void NodeCounter::visit(const Jump&) {
+	counts[Node::JUMP]++;
+}
+
+
+
+const int FlatPrinter::tab_size = 4;
+
+
+FlatPrinter::FlatPrinter(ostream& out) : out(out) {}
+
+
+void FlatPrinter::print_tabs(const int& N) const {
+	out << string(N * tab_size, ' ');
+}
+
+
+void FlatPrinter::visit_root(const FlatAST& ast) {
+	for (auto it : ast.roots)
+		ast.accept(*this, it);
+}
+
+
+void FlatPrinter::visit_var_declaration(const FlatAST& ast, const FlatAST::Index& node) {
+	out << ast.text(node) << " " << ast.symbols->name(ast.payloads[node]);
+	if (ast.count[node]) {
+		out << " = ";
+		ast.accept(*this, ast.child(node, 0));
+	}
+	if (level == 0)
+		out << ";" << endl;
+}
+
+
+void FlatPrinter::visit_func_prot(const FlatAST& ast, const FlatAST::Index& node) {
+	out << ast.text(node) << " " << ast.symbols->name(ast.payloads[node]) << "(";
+	for (uint32_t i = 0, size = ast.count[node]; i < size; i++) {
+		auto arg = ast.child(node, i);
+		out << ast.text(arg) << " " << ast.symbols->name(ast.payloads[arg]);
+		if (ast.count[arg]) {
+			out << " = ";
+			ast.accept(*this, ast.child(arg, 0));
+		}
+		if (i != size - 1)
+			out << ", ";
+	}
+	out << ")";
+}
+
+
+void FlatPrinter::visit_func_def(const FlatAST& ast, const FlatAST::Index& node) {
+	ast.accept(*this, ast.child(node, 0));
+	out << " {" << endl;
+	ast.accept(*this, ast.child(node, 1));
+	out << "}" << endl;
+	out << endl;
+}
+
+
+void FlatPrinter::visit_block(const FlatAST& ast, const FlatAST::Index& node) {
+	int block_level = ast.payloads[node];
+	level = block_level;
+	for (uint32_t i = 0; i < ast.count[node]; i++) {
+		auto statement = ast.child(node, i);
+		print_tabs(block_level);
+		ast.accept(*this, statement);
+		if (ast.kinds[statement] != Node::CONDITIONAL && ast.kinds[statement] != Node::LOOP)
+			out << ";" << endl;
+	}
+}
+
+
+void FlatPrinter::visit_expr(const FlatAST& ast, const FlatAST::Index& node) {
+	auto size = ast.count[node];
+	switch (ast.subkinds[node]) {
+		case Expr::CONST:
+			out << ast.text(node);
+			break;
+		case Expr::VAR:
+			out << ast.symbols->name(ast.payloads[node]);
+			break;
+		case Expr::CHAR:
+			out << "\'" << ast.text(node) << "\'";
+			break;
+		case Expr::STRING:
+			out << "\"" << ast.text(node) << "\"";
+			break;
+		case Expr::PRE_UNARY_OP:
+			out << ast.text(node);
+			ast.accept(*this, ast.child(node, 0));
+			break;
+		case Expr::POST_UNARY_OP:
+			ast.accept(*this, ast.child(node, 0));
+			out << ast.text(node);
+			break;
+		case Expr::CAST:
+			out << "(" << ast.text(node) << ")";
+			ast.accept(*this, ast.child(node, 0));
+			break;
+		case Expr::BINARY_OP:
+			if (size) {
+				ast.accept(*this, ast.child(node, 0));
+				out << " " << ast.text(node) << " ";
+				ast.accept(*this, ast.child(node, 1));
+			} else
+				out << ast.text(node);
+			break;
+		case Expr::FUNC:
+		case Expr::BUILTIN_FUNC:
+		case Expr::MATH_FUNC:
+			if (ast.subkinds[node] == Expr::FUNC)
+				out << ast.symbols->name(ast.payloads[node]) << "(";
+			else
+				out << ast.text(node) << "(";
+			for (uint32_t i = 0; i < size; i++) {
+				ast.accept(*this, ast.child(node, i));
+				if (i != size - 1)
+					out << ", ";
+			}
+			out << ")";
+			break;
+	}
+}
+
+
+void FlatPrinter::visit_conditional(const FlatAST& ast, const FlatAST::Index& node) {
+	auto block = ast.child(node, ast.count[node] - 1);
+	if (ast.subkinds[node] == Conditional::IF || ast.subkinds[node] == Conditional::ELIF) {
+		out << (ast.subkinds[node] == Conditional::IF ? "if (" : "elif (");
+		ast.accept(*this, ast.child(node, 0));
+		out << ") {" << endl;
+	} else
+		out << "else {" << endl;
+	ast.accept(*this, block);
+	print_tabs(ast.payloads[block] - 1);
+	out << "}" << endl;
+}
+
+
+void FlatPrinter::visit_loop(const FlatAST& ast, const FlatAST::Index& node) {
+	auto block = ast.child(node, 1);
+	out << "while (";
+	ast.accept(*this, ast.child(node, 0));
+	out << ") {" << endl;
+	ast.accept(*this, block);
+	print_tabs(ast.payloads[block] - 1);
+	out << "}" << endl;
+}
+
+
+void FlatPrinter::visit_return(const FlatAST& ast, const FlatAST::Index& node) {
+	out << "return ";
+	ast.accept(*this, ast.child(node, 0));
+}
+
+
+void FlatPrinter::visit_jump(const FlatAST& ast, const FlatAST::Index& node) {
+	out << (ast.subkinds[node] == Jump::BREAK ? "break" : "continue");
 }
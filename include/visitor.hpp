@@ -2,6 +2,7 @@
 
 
 #include "syntaxer/tree.hpp"
+#include "syntaxer/flat_tree.hpp"
 
 
 class ConstVisitor {
@@ -18,12 +19,30 @@ public:
     virtual void visit(const Jump&) = 0;
 };
 
+// Visitor for passes that rewrite the tree in place.
+class Visitor {
+public:
+    virtual void visit(AST&) = 0;
+    virtual void visit(VarDeclaration&) = 0;
+    virtual void visit(FuncProt&) = 0;
+    virtual void visit(FuncDef&) = 0;
+    virtual void visit(Block&) = 0;
+    virtual void visit(Expr&) = 0;
+    virtual void visit(Conditional&) = 0;
+    virtual void visit(Loop&) = 0;
+    virtual void visit(Return&) = 0;
+    virtual void visit(Jump&) = 0;
+};
+
 class Printer : public ConstVisitor {
 private:
     static const int tab_size;
-    static int level;
+    ostream& out;
+    int level = 0;
+    const SymbolTable* symbols = nullptr;
 
 public:
+    explicit Printer(ostream& = cout);
     void print_tabs(const int&) const;
     virtual void visit(const AST&) override;
     virtual void visit(const VarDeclaration&) override;
@@ -38,3 +57,43 @@ public:
 };
 
 
+// Counts nodes per NodeType.
+class NodeCounter : public ConstVisitor {
+public:
+    size_t counts[Node::JUMP + 1] = {};
+
+    size_t total() const;
+    virtual void visit(const AST&) override;
+    virtual void visit(const VarDeclaration&) override;
+    virtual void visit(const FuncProt&) override;
+    virtual void visit(const FuncDef&) override;
+    virtual void visit(const Block&) override;
+    virtual void visit(const Expr&) override;
+    virtual void visit(const Conditional&) override;
+    virtual void visit(const Loop&) override;
+    virtual void visit(const Return&) override;
+    virtual void visit(const Jump&) override;
+};
+
+
+// Printer over a FlatAST; prints exactly what Printer prints for the source AST.
+class FlatPrinter : public FlatConstVisitor {
+private:
+    static const int tab_size;
+    ostream& out;
+    int level = 0;
+
+public:
+    explicit FlatPrinter(ostream& = cout);
+    void print_tabs(const int&) const;
+    virtual void visit_root(const FlatAST&) override;
+    virtual void visit_var_declaration(const FlatAST&, const FlatAST::Index&) override;
+    virtual void visit_func_prot(const FlatAST&, const FlatAST::Index&) override;
+    virtual void visit_func_def(const FlatAST&, const FlatAST::Index&) override;
+    virtual void visit_block(const FlatAST&, const FlatAST::Index&) override;
+    virtual void visit_expr(const FlatAST&, const FlatAST::Index&) override;
+    virtual void visit_conditional(const FlatAST&, const FlatAST::Index&) override;
+    virtual void visit_loop(const FlatAST&, const FlatAST::Index&) override;
+    virtual void visit_return(const FlatAST&, const FlatAST::Index&) override;
+    virtual void visit_jump(const FlatAST&, const FlatAST::Index&) override;
+};
@@ -0,0 +1,48 @@
+#include "bytecode.hpp"
+#include <algorithm>
+
+
+static_assert(sizeof(Instruction) == 8, "Instruction should stay 8 bytes");
+
+
+const char* Instruction::name(const Opcode& op) {
+    static const char* names[] = {
+#define BYTECODE_NAME(name) #name,
+        BYTECODE_OPCODES(BYTECODE_NAME)
+#undef BYTECODE_NAME
+    };
+    return op < OPCODE_COUNT ? names[op] : "?";
+}
+
+
+uint32_t Function::offset(const size_t& pc) const {
+    auto after = upper_bound(lines.begin(), lines.end(), pc, [](const size_t& pc, const auto& line) { return pc < line.pc; });
+    return after == lines.begin() ? UINT32_MAX : prev(after)->offset;
+}
+
+
+string Program::name(const size_t& function) const {
+    return function == init ? string("<init>") : symbols->name(functions[function].name);
+}
+
+
+void Program::disassemble(ostream& out) const {
+    for (size_t f = 0; f < functions.size(); f++) {
+        const auto& function = functions[f];
+        out << name(f) << ": arity " << int(function.arity) << ", registers " << function.registers << endl;
+        for (size_t i = 0; i < function.code.size(); i++) {
+            const auto& ins = function.code[i];
+            out << "    " << i << "\t" << Instruction::name(ins.op) << "\t" << int(ins.a) << " " << int(ins.b) << " "
+                << int(ins.c) << " " << ins.d;
+            if (ins.op == Instruction::LOADK)
+                out << "\t; " << constants[ins.d];
+            else if (ins.op == Instruction::LOADL)
+                out << "\t; " << integers[ins.d];
+            else if (ins.op == Instruction::CALL)
+                out << "\t; " << symbols->name(functions[ins.d].name);
+            else if (ins.op >= Instruction::JMP && ins.op <= Instruction::IJLE)
+                out << "\t; -> " << i + 1 + ins.d;
+            out << endl;
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <iostream>
+#include <cstdint>
+#include "../lexer/symbols.hpp"
+
+
+using namespace std;
+
+
+// A register or global: int, char and bool values are held in i (char wrapped
+// to 8 bits, bool 0 or 1), double values in d. The compiler knows the static
+// type of every register from the TypeChecker and picks opcodes to match.
+union Value {
+    int64_t i;
+    double d;
+};
+
+
+// Register bytecode. A function addresses a window R[0 .. registers) of the VM
+// stack and receives its arguments in R[0 .. arity). Operands a, b and c are
+// registers unless noted; d is a jump offset relative to the next instruction,
+// an index into Program::constants, integers, strings or functions, or an
+// immediate. Opcodes prefixed with I work on .i with wrapping arithmetic, the
+// others on .d; comparisons and TO* conversions always produce .i.
+//
+//   MOVE a b          R[a] = R[b]
+//   LOADK a d         R[a].d = constants[d]
+//   LOADL a d         R[a].i = integers[d]
+//   LOADI a d         R[a].i = d
+//   GETGLOBAL a d     R[a] = globals[d]
+//   SETGLOBAL a d     globals[d] = R[a]
+//   ADD .. POW a b c  R[a] = R[b] op R[c]; IDIV and IMOD truncate and fail on zero
+//   ADDI a b d        R[a] = R[b] + d
+//   EQ .. LE a b c    R[a].i = R[b] op R[c] ? 1 : 0 (> and >= swap the operands)
+//   NEG .. LOG a b    R[a] = op(R[b]); TOINT truncates a double (INT64_MIN when out
+//                     of range), TOCHAR wraps an int, TOBOOL and ITOBOOL give 0 or 1
+//   JMP d             pc += d
+//   JT a c d          if ((R[a].i != 0) == c) pc += d
+//   JEQ .. JLE a b c d   if ((R[a] op R[b]) == c) pc += d
+//   CALL a d          calls functions[d] with its frame at R[a ..], result in R[a]
+//   RET a, RET0       returns R[a] or 0
+//   READ a            R[a].d = number read from stdin
+//   PUTN a, PUTI a    writes R[a].d or R[a].i
+//   PUTS d            writes strings[d]
+//   PRINTF a c d      printf(strings[d], R[a .. a + c)), reading .i or .d by conversion
+#define BYTECODE_OPCODES(X) \
+    X(MOVE) X(LOADK) X(LOADL) X(LOADI) X(GETGLOBAL) X(SETGLOBAL) \
+    X(ADD) X(SUB) X(MUL) X(DIV) X(MOD) X(POW) X(ADDI) \
+    X(IADD) X(ISUB) X(IMUL) X(IDIV) X(IMOD) X(IADDI) \
+    X(EQ) X(NE) X(LT) X(LE) X(IEQ) X(INE) X(ILT) X(ILE) \
+    X(NEG) X(INEG) X(NOT) X(TOINT) X(TOCHAR) X(TOBOOL) X(ITOBOOL) X(TODOUBLE) \
+    X(ABS) X(IABS) X(SGN) X(ISGN) X(SIN) X(COS) X(EXP) X(LOG) \
+    X(JMP) X(JT) X(JEQ) X(JNE) X(JLT) X(JLE) X(IJEQ) X(IJNE) X(IJLT) X(IJLE) \
+    X(CALL) X(RET) X(RET0) \
+    X(READ) X(PUTN) X(PUTI) X(PUTS) X(PRINTF)
+
+
+class Instruction {
+public:
+    enum Opcode : uint8_t {
+#define BYTECODE_ENUM(name) name,
+        BYTECODE_OPCODES(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+        OPCODE_COUNT
+    };
+
+    Opcode op;
+    uint8_t a = 0, b = 0, c = 0;
+    int32_t d = 0;
+
+    static const char* name(const Opcode&);
+};
+
+
+class Function {
+public:
+    struct Line {
+        uint32_t pc, offset; // first pc and source offset of a statement
+    };
+
+    Symbol name;
+    uint8_t arity = 0;
+    uint16_t registers = 0; // frame size
+    vector<Instruction> code;
+    // Every statement in pc order: the statement of an instruction is the last
+    // entry at or before its pc.
+    vector<Line> lines;
+
+    // Source offset of the statement the instruction at pc belongs to, Node::no_offset
+    // (UINT32_MAX) when the function has no line table.
+    uint32_t offset(const size_t& pc) const;
+};
+
+
+class Program {
+public:
+    vector<Function> functions;
+    vector<double> constants;
+    vector<int64_t> integers; // int literals that do not fit LOADI
+    vector<string> strings;
+    uint32_t globals = 0;
+    uint32_t init = 0; // runs the global initializers
+    uint32_t entry = 0; // main
+    shared_ptr<SymbolTable> symbols;
+    string source_name; // file the program was compiled from, empty when unknown; not cached
+
+    // The function's name, "<init>" for the initializer.
+    string name(const size_t& function) const;
+    void disassemble(ostream&) const;
+};
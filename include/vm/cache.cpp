@@ -0,0 +1,440 @@
+#include "cache.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CACHE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// File layout: a Header, then 8-byte aligned sections in this order:
+//   FunctionRecord[functions]   code ranges index the instruction section
+//   Instruction[instructions]   the code of all functions, back to back
+//   LineEntry[lines]            the line tables of all functions, back to back
+//   double[constants], int64_t[integers]
+//   uint64_t[strings] end offsets, then the string bytes
+//   uint64_t[symbols] end offsets, then the symbol names, keywords included
+namespace {
+
+
+const char magic[8] = {'P', 'L', 'G', 'C', 'A', 'C', 'H', 'E'};
+const uint32_t byte_order = 0x01020304;
+
+
+struct Header {
+    char magic[8];
+    uint32_t version, opcodes, byte_order, value_size;
+    uint64_t source_hash, source_size;
+    uint64_t payload_hash; // of everything after the header
+    uint64_t size; // of the whole file
+    uint32_t globals, init, entry;
+    uint32_t functions, instructions, constants, integers, strings, symbols;
+    uint32_t lines;
+    uint64_t string_bytes, symbol_bytes;
+};
+
+static_assert(sizeof(Header) % 8 == 0, "ProgramCache: sections after the header must stay aligned");
+
+
+struct FunctionRecord {
+    Symbol name;
+    uint32_t code, length;
+    uint32_t lines, line_count; // range of the line section
+    uint16_t registers;
+    uint8_t arity;
+    uint8_t reserved;
+};
+
+
+using LineEntry = Function::Line;
+
+static_assert(sizeof(LineEntry) == 8 && is_trivially_copyable_v<LineEntry>,
+              "ProgramCache: line entries are stored as two uint32_t");
+
+
+size_t align(const size_t& size) {
+    return (size + 7) & ~size_t(7);
+}
+
+
+// Section offsets implied by the counts in a header.
+struct Layout {
+    size_t functions, instructions, lines, constants, integers, string_ends, string_bytes, symbol_ends, symbol_bytes, end;
+
+    explicit Layout(const Header& h) {
+        functions = sizeof(Header);
+        instructions = functions + align(h.functions * sizeof(FunctionRecord));
+        lines = instructions + align(h.instructions * sizeof(Instruction));
+        constants = lines + h.lines * sizeof(LineEntry);
+        integers = constants + h.constants * sizeof(double);
+        string_ends = integers + h.integers * sizeof(int64_t);
+        string_bytes = string_ends + h.strings * sizeof(uint64_t);
+        symbol_ends = string_bytes + align(h.string_bytes);
+        symbol_bytes = symbol_ends + h.symbols * sizeof(uint64_t);
+        end = symbol_bytes + align(h.symbol_bytes);
+    }
+};
+
+
+// The bytes of a file, mapped read-only where the platform allows.
+class FileView {
+public:
+    explicit FileView(const string& path) {
+#ifdef CACHE_MMAP
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* memory = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (memory != MAP_FAILED) {
+                bytes = static_cast<const char*>(memory);
+                length = info.st_size;
+            }
+        }
+        close(fd);
+#else
+        ifstream fin(path, ios::in | ios::binary | ios::ate);
+        if (!fin.is_open())
+            return;
+        auto size = fin.tellg();
+        if (size < 0)
+            return;
+        copy.resize(size);
+        fin.seekg(0);
+        if (fin.read(copy.data(), copy.size())) {
+            bytes = copy.data();
+            length = copy.size();
+        }
+#endif
+    }
+
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+
+    ~FileView() {
+#ifdef CACHE_MMAP
+        if (bytes)
+            munmap(const_cast<char*>(bytes), length);
+#endif
+    }
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifndef CACHE_MMAP
+    string copy;
+#endif
+};
+
+
+template<class T>
+void append(string& image, const T* items, const size_t& count) {
+    image.append(reinterpret_cast<const char*>(items), count * sizeof(T));
+}
+
+
+void pad(string& image) {
+    image.resize(align(image.size()), '\0');
+}
+
+
+// Appends the end offsets of `texts` and then their bytes; returns the byte count.
+template<class F>
+uint64_t append_texts(string& image, const size_t& count, const F& text) {
+    uint64_t end = 0;
+    for (size_t i = 0; i < count; i++) {
+        end += text(i).size();
+        append(image, &end, 1);
+    }
+    for (size_t i = 0; i < count; i++)
+        image += text(i);
+    pad(image);
+    return end;
+}
+
+
+// Reads texts written by append_texts; false when the offsets are out of order or bounds.
+template<class F>
+bool read_texts(const char* ends, const char* bytes, const size_t& count, const uint64_t& total, const F& take) {
+    uint64_t begin = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t end;
+        memcpy(&end, ends + i * sizeof(uint64_t), sizeof(end));
+        if (end < begin || end > total)
+            return false;
+        if (!take(string_view(bytes + begin, end - begin)))
+            return false;
+        begin = end;
+    }
+    return true;
+}
+
+
+// Whether the operands of every instruction stay inside the function's frame
+// and code and the program's tables, and the code cannot run off its end. The
+// Compiler guarantees this and the VM relies on it without checking.
+bool valid(const Function& function, const Program& program) {
+    const auto& code = function.code;
+    if (code.empty() || function.arity > function.registers)
+        return false;
+    auto last = code.back().op;
+    if (last != Instruction::RET && last != Instruction::RET0 && last != Instruction::JMP)
+        return false;
+    auto reg = [&](const uint8_t& r) { return r < function.registers; };
+    auto index = [](const int32_t& d, const size_t& size) { return d >= 0 && size_t(d) < size; };
+    for (size_t pc = 0; pc < code.size(); pc++) {
+        const auto& ins = code[pc];
+        int64_t target = int64_t(pc) + 1 + ins.d;
+        bool jump = target >= 0 && target < int64_t(code.size()), ok;
+        switch (ins.op) {
+            case Instruction::LOADI:
+            case Instruction::READ:
+            case Instruction::PUTN:
+            case Instruction::PUTI:
+            case Instruction::RET:
+                ok = reg(ins.a);
+                break;
+            case Instruction::LOADK:
+                ok = reg(ins.a) && index(ins.d, program.constants.size());
+                break;
+            case Instruction::LOADL:
+                ok = reg(ins.a) && index(ins.d, program.integers.size());
+                break;
+            case Instruction::GETGLOBAL:
+            case Instruction::SETGLOBAL:
+                ok = reg(ins.a) && index(ins.d, program.globals);
+                break;
+            case Instruction::MOVE:
+            case Instruction::ADDI: case Instruction::IADDI:
+            case Instruction::NEG: case Instruction::INEG: case Instruction::NOT:
+            case Instruction::TOINT: case Instruction::TOCHAR: case Instruction::TOBOOL:
+            case Instruction::ITOBOOL: case Instruction::TODOUBLE:
+            case Instruction::ABS: case Instruction::IABS: case Instruction::SGN: case Instruction::ISGN:
+            case Instruction::SIN: case Instruction::COS: case Instruction::EXP: case Instruction::LOG:
+                ok = reg(ins.a) && reg(ins.b);
+                break;
+            case Instruction::ADD: case Instruction::SUB: case Instruction::MUL:
+            case Instruction::DIV: case Instruction::MOD: case Instruction::POW:
+            case Instruction::IADD: case Instruction::ISUB: case Instruction::IMUL:
+            case Instruction::IDIV: case Instruction::IMOD:
+            case Instruction::EQ: case Instruction::NE: case Instruction::LT: case Instruction::LE:
+            case Instruction::IEQ: case Instruction::INE: case Instruction::ILT: case Instruction::ILE:
+                ok = reg(ins.a) && reg(ins.b) && reg(ins.c);
+                break;
+            case Instruction::JMP:
+                ok = jump;
+                break;
+            case Instruction::JT:
+                ok = reg(ins.a) && jump;
+                break;
+            case Instruction::JEQ: case Instruction::JNE: case Instruction::JLT: case Instruction::JLE:
+            case Instruction::IJEQ: case Instruction::IJNE: case Instruction::IJLT: case Instruction::IJLE:
+                ok = reg(ins.a) && reg(ins.b) && jump;
+                break;
+            case Instruction::CALL:
+                ok = reg(ins.a) && index(ins.d, program.functions.size());
+                break;
+            case Instruction::RET0:
+                ok = true;
+                break;
+            case Instruction::PUTS:
+                ok = index(ins.d, program.strings.size());
+                break;
+            case Instruction::PRINTF:
+                ok = reg(ins.a) && ins.a + ins.c <= function.registers && index(ins.d, program.strings.size());
+                break;
+            default:
+                ok = false;
+        }
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+
+}
+
+
+ProgramCache::ProgramCache(string directory) : dir(move(directory)) {}
+
+
+uint64_t ProgramCache::hash(const string_view& text) {
+    const uint64_t k = 0x9fb21c651e98df25;
+    uint64_t h = text.size() * k;
+    size_t i = 0;
+    for (; i + 8 <= text.size(); i += 8) {
+        uint64_t word;
+        memcpy(&word, text.data() + i, 8);
+        h = (h ^ word) * k;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, text.data() + i, text.size() - i);
+    h = (h ^ tail) * k;
+    return h ^ (h >> 32);
+}
+
+
+string ProgramCache::path(const string_view& source) const {
+    char name[24];
+    snprintf(name, sizeof(name), "%016llx.plc", static_cast<unsigned long long>(hash(source)));
+    return dir + "/" + name;
+}
+
+
+bool ProgramCache::store(const string_view& source, const Program& program) const {
+    Header header{};
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.opcodes = Instruction::OPCODE_COUNT;
+    header.byte_order = byte_order;
+    header.value_size = sizeof(Value);
+    header.source_hash = hash(source);
+    header.source_size = source.size();
+    header.globals = program.globals;
+    header.init = program.init;
+    header.entry = program.entry;
+    header.functions = program.functions.size();
+    header.constants = program.constants.size();
+    header.integers = program.integers.size();
+    header.strings = program.strings.size();
+    header.symbols = program.symbols->size();
+
+    string image(sizeof(Header), '\0');
+    uint32_t code = 0, lines = 0;
+    for (const auto& function : program.functions) {
+        FunctionRecord record{function.name, code, uint32_t(function.code.size()), lines, uint32_t(function.lines.size()),
+                              function.registers, function.arity, 0};
+        append(image, &record, 1);
+        code += record.length;
+        lines += record.line_count;
+    }
+    pad(image);
+    header.instructions = code;
+    header.lines = lines;
+    for (const auto& function : program.functions)
+        append(image, function.code.data(), function.code.size());
+    pad(image);
+    for (const auto& function : program.functions)
+        append(image, function.lines.data(), function.lines.size());
+    append(image, program.constants.data(), program.constants.size());
+    append(image, program.integers.data(), program.integers.size());
+    header.string_bytes = append_texts(image, program.strings.size(), [&](size_t i) -> const string& {
+        return program.strings[i];
+    });
+    header.symbol_bytes = append_texts(image, program.symbols->size(), [&](size_t i) -> const string& {
+        return program.symbols->name(i);
+    });
+    header.size = image.size();
+    header.payload_hash = hash(string_view(image).substr(sizeof(Header)));
+    memcpy(image.data(), &header, sizeof(header));
+
+    // written beside the final name and renamed over it, so readers never see half a file
+    error_code error;
+    filesystem::create_directories(dir, error);
+    auto target = path(source);
+    auto unique = chrono::steady_clock::now().time_since_epoch().count() ^ std::hash<thread::id>()(this_thread::get_id());
+    auto temporary = target + "." + to_string(unique) + ".tmp";
+    bool written;
+    {
+        ofstream fout(temporary, ios::out | ios::binary | ios::trunc);
+        written = fout.write(image.data(), image.size()) && fout.flush();
+    }
+    if (written)
+        filesystem::rename(temporary, target, error);
+    if (!written || error) {
+        filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+
+optional<Program> ProgramCache::load(const string_view& source) const {
+    FileView file(path(source));
+    if (file.size() < sizeof(Header))
+        return nullopt;
+    Header header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, magic, sizeof(magic)) || header.version != version ||
+        header.opcodes != Instruction::OPCODE_COUNT || header.byte_order != byte_order ||
+        header.value_size != sizeof(Value))
+        return nullopt;
+    if (header.source_size != source.size() || header.source_hash != hash(source))
+        return nullopt;
+    if (header.size != file.size() || header.string_bytes > header.size || header.symbol_bytes > header.size)
+        return nullopt;
+    Layout layout(header);
+    if (layout.end != header.size ||
+        header.payload_hash != hash(string_view(file.data(), file.size()).substr(sizeof(Header))))
+        return nullopt;
+    if (header.init >= header.functions || header.entry >= header.functions)
+        return nullopt;
+
+    const char* base = file.data();
+    Program program;
+    program.globals = header.globals;
+    program.init = header.init;
+    program.entry = header.entry;
+
+    // interning in stored order gives every name its old symbol, keywords first
+    program.symbols = make_shared<SymbolTable>();
+    Symbol next = 0;
+    bool symbols_valid = read_texts(base + layout.symbol_ends, base + layout.symbol_bytes, header.symbols,
+                                    header.symbol_bytes, [&](const string_view& name) {
+        return program.symbols->intern(name) == next++;
+    });
+    if (!symbols_valid || program.symbols->size() != header.symbols)
+        return nullopt;
+    program.strings.reserve(header.strings);
+    read_texts(base + layout.string_ends, base + layout.string_bytes, header.strings, header.string_bytes,
+               [&](const string_view& text) {
+        program.strings.emplace_back(text);
+        return true;
+    });
+    if (program.strings.size() != header.strings)
+        return nullopt;
+
+    program.functions.resize(header.functions);
+    for (size_t i = 0; i < header.functions; i++) {
+        FunctionRecord record;
+        memcpy(&record, base + layout.functions + i * sizeof(record), sizeof(record));
+        if (record.code > header.instructions || record.length > header.instructions - record.code ||
+            record.lines > header.lines || record.line_count > header.lines - record.lines ||
+            (record.name >= header.symbols && i != header.init))
+            return nullopt;
+        auto& function = program.functions[i];
+        function.name = record.name;
+        function.arity = record.arity;
+        function.registers = record.registers;
+        function.code.resize(record.length);
+        memcpy(function.code.data(), base + layout.instructions + record.code * sizeof(Instruction),
+               record.length * sizeof(Instruction));
+        function.lines.resize(record.line_count);
+        memcpy(function.lines.data(), base + layout.lines + record.lines * sizeof(LineEntry),
+               record.line_count * sizeof(LineEntry));
+    }
+    program.constants.resize(header.constants);
+    memcpy(program.constants.data(), base + layout.constants, header.constants * sizeof(double));
+    program.integers.resize(header.integers);
+    memcpy(program.integers.data(), base + layout.integers, header.integers * sizeof(int64_t));
+    for (const auto& function : program.functions)
+        if (!valid(function, program))
+            return nullopt;
+    return program;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+
+#include "bytecode.hpp"
+#include <optional>
+#include <string_view>
+
+
+// Compiled programs on disk, one file per source text, named by a hash of the
+// text. A cached program skips lexing, parsing, checking and compiling: the
+// file is mapped and its sections, which hold offsets rather than pointers,
+// are copied straight into a Program. Files from another format version,
+// opcode set or byte order, for another source, or damaged ones, including
+// files whose instructions reach outside their frame, code or the program's
+// tables, are ignored and replaced on the next store().
+class ProgramCache {
+public:
+    // Bump whenever the file layout or the Compiler's output for some source changes.
+    static constexpr uint32_t version = 2;
+
+    explicit ProgramCache(string directory);
+
+    // The program stored for `source`, or nullopt when there is no valid one.
+    optional<Program> load(const string_view& source) const;
+    // Writes the program atomically; returns false when the directory is not writable.
+    bool store(const string_view& source, const Program&) const;
+
+    string path(const string_view& source) const;
+    const string& directory() const { return dir; }
+
+    // 64-bit content hash for cache keys and file checks; not cryptographic.
+    static uint64_t hash(const string_view&);
+
+private:
+    string dir;
+};
@@ -0,0 +1,736 @@
+#include "compiler.hpp"
+#include "../syntaxer/type_checker.hpp"
+#include <bit>
+#include <cmath>
+
+
+static string unescape(const string_view& text) {
+    string result;
+    result.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] != '\\' || i + 1 == text.size()) {
+            result += text[i];
+            continue;
+        }
+        switch (text[++i]) {
+            case 'n': result += '\n'; break;
+            case 't': result += '\t'; break;
+            case 'r': result += '\r'; break;
+            case '0': result += '\0'; break;
+            default: result += text[i]; break;
+        }
+    }
+    return result;
+}
+
+
+Compiler::Compiler(Program& program) : program(program) {}
+
+
+Program Compiler::compile(AST& ast) {
+    TypeChecker::check(ast);
+    return generate(ast);
+}
+
+
+Program Compiler::generate(const AST& ast) {
+    Program program;
+    program.symbols = ast.symbols;
+    Compiler compiler(program);
+    compiler.visit(ast);
+    return program;
+}
+
+
+DataType Compiler::value_type(const string_view& datatype) {
+    auto type = parse_type(datatype);
+    if (type == DataType::UNKNOWN || type == DataType::STRING)
+        throw runtime_error("Compiler: Unsupported type " + string(datatype));
+    return type;
+}
+
+
+const string& Compiler::name(const Symbol& symbol) const {
+    return program.symbols->name(symbol);
+}
+
+
+size_t Compiler::emit(const Instruction::Opcode& op, const int& a, const int& b, const int& c, const int32_t& d) {
+    function->code.push_back(Instruction{op, uint8_t(a), uint8_t(b), uint8_t(c), d});
+    return function->code.size() - 1;
+}
+
+
+size_t Compiler::here() const {
+    return function->code.size();
+}
+
+
+// Starts a line table entry for the code a statement is about to emit. A
+// statement that emitted nothing gives its entry to the next one.
+void Compiler::mark(const Node& node) {
+    if (node.offset == Node::no_offset)
+        return;
+    auto& lines = function->lines;
+    uint32_t pc = here();
+    if (!lines.empty() && lines.back().pc == pc)
+        lines.back().offset = node.offset;
+    else if (lines.empty() || lines.back().offset != node.offset)
+        lines.push_back({pc, node.offset});
+}
+
+
+void Compiler::patch(const size_t& jump, const size_t& target) {
+    function->code[jump].d = int32_t(target) - int32_t(jump + 1);
+}
+
+
+void Compiler::patch(const vector<size_t>& jumps, const size_t& target) {
+    for (auto it : jumps)
+        patch(it, target);
+}
+
+
+int Compiler::temp() {
+    if (top >= UINT8_MAX)
+        throw runtime_error("Compiler: Function " + name(function->name) + " needs more than 255 registers");
+    function->registers = max<uint16_t>(function->registers, top + 1);
+    return top++;
+}
+
+
+uint32_t Compiler::constant(const double& value) {
+    auto [it, inserted] = constant_index.try_emplace(bit_cast<uint64_t>(value), program.constants.size());
+    if (inserted)
+        program.constants.push_back(value);
+    return it->second;
+}
+
+
+uint32_t Compiler::integer(const int64_t& value) {
+    auto [it, inserted] = integer_index.try_emplace(value, program.integers.size());
+    if (inserted)
+        program.integers.push_back(value);
+    return it->second;
+}
+
+
+uint32_t Compiler::string_constant(const string_view& text) {
+    auto [it, inserted] = string_index.try_emplace(string(text), program.strings.size());
+    if (inserted)
+        program.strings.push_back(string(text));
+    return it->second;
+}
+
+
+Compiler::Variable Compiler::variable(const Binding& binding) const {
+    if (binding.depth == 0)
+        return {global_types[binding.slot], true, binding.slot};
+    return {local_types[binding.slot], false, binding.slot};
+}
+
+
+// Conversions that keep the representation: char and bool are already ints.
+const Expr& Compiler::skip_widening(const Expr& expr) {
+    const Expr* it = &expr;
+    while (it->type == Expr::CAST) {
+        auto from = it->branches[0]->value_type, to = it->value_type;
+        if (from != to && !(to == DataType::INT && (from == DataType::CHAR || from == DataType::BOOL)) &&
+            !(to == DataType::CHAR && from == DataType::BOOL))
+            break;
+        it = it->branches[0].get();
+    }
+    return *it;
+}
+
+
+void Compiler::convert(const int& dst, const int& src, const DataType& from, const DataType& to) {
+    if (to == DataType::DOUBLE && from != DataType::DOUBLE)
+        emit(Instruction::TODOUBLE, dst, src);
+    else if (to == DataType::BOOL && from != DataType::BOOL)
+        emit(from == DataType::DOUBLE ? Instruction::TOBOOL : Instruction::ITOBOOL, dst, src);
+    else if (to == DataType::CHAR && from == DataType::DOUBLE) {
+        emit(Instruction::TOINT, dst, src);
+        emit(Instruction::TOCHAR, dst, dst);
+    } else if (to == DataType::CHAR && from == DataType::INT)
+        emit(Instruction::TOCHAR, dst, src);
+    else if (to == DataType::INT && from == DataType::DOUBLE)
+        emit(Instruction::TOINT, dst, src);
+    else if (dst != src)
+        emit(Instruction::MOVE, dst, src);
+}
+
+
+void Compiler::load(const double& value, const DataType& type, const int& dst) {
+    if (type == DataType::DOUBLE) {
+        emit(Instruction::LOADK, dst, 0, 0, constant(value));
+        return;
+    }
+    load(int64_t(Expr::convert(value, type)), dst);
+}
+
+
+void Compiler::load(const int64_t& number, const int& dst) {
+    if (number >= INT32_MIN && number <= INT32_MAX)
+        emit(Instruction::LOADI, dst, 0, 0, int32_t(number));
+    else
+        emit(Instruction::LOADL, dst, 0, 0, integer(number));
+}
+
+
+// Integer literals load their exact int64 value, which the double in Expr::number may not hold.
+void Compiler::load(const Expr& constant, const DataType& type, const int& dst) {
+    if (constant.is_integer() && is_integral_type(type))
+        load(Expr::convert_integer(constant.integer, type), dst);
+    else
+        load(Expr::convert(constant.number, type), type, dst);
+}
+
+
+int Compiler::operand(const Expr& operand) {
+    const auto& expr = skip_widening(operand);
+    if (expr.type == Expr::VAR) {
+        auto var = variable(expr.binding);
+        if (!var.global)
+            return var.index;
+    }
+    int reg = temp();
+    this->expr(expr, reg);
+    return reg;
+}
+
+
+// The left operand of an instruction writing dst: computed straight into dst
+// unless it is a local already in a register or `later`, evaluated after it,
+// uses dst. A left-nested chain a + b + c + ... then needs no register per level.
+int Compiler::operand(const Expr& operand, const int& dst, const Expr* later) {
+    const auto& expr = skip_widening(operand);
+    if ((expr.type == Expr::VAR && !variable(expr.binding).global) || (later && uses(*later, uint8_t(dst))))
+        return this->operand(operand);
+    this->expr(expr, dst);
+    return dst;
+}
+
+
+// Whether evaluating expr reads or writes the register of a local.
+bool Compiler::uses(const Expr& expr, const uint8_t& reg) const {
+    if (expr.type == Expr::VAR) {
+        auto var = variable(expr.binding);
+        if (!var.global && var.index == reg)
+            return true;
+    }
+    for (const auto& it : expr.branches)
+        if (uses(*it, reg))
+            return true;
+    return false;
+}
+
+
+void Compiler::expr(const Expr& expr, const int& dst) {
+    auto saved = top;
+    bool integral = is_integral_type(expr.value_type);
+    switch (expr.type) {
+        case Expr::CONST:
+            load(expr, expr.value_type, dst);
+            break;
+        case Expr::CHAR:
+            load(expr.value.empty() ? 0 : expr.value[0], expr.value_type, dst);
+            break;
+        case Expr::CAST: {
+            const auto& value = skip_widening(expr);
+            const auto& child = *expr.branches[0];
+            if (&value != &expr)
+                this->expr(value, dst);
+            else if (child.type == Expr::CONST)
+                load(child, expr.value_type, dst);
+            else
+                convert(dst, operand(child), child.value_type, expr.value_type);
+            break;
+        }
+        case Expr::STRING:
+            throw runtime_error("Compiler: String literals are only supported as print and printf arguments");
+        case Expr::VAR: {
+            auto var = variable(expr.binding);
+            if (var.global)
+                emit(Instruction::GETGLOBAL, dst, 0, 0, var.index);
+            else if (int(var.index) != dst)
+                emit(Instruction::MOVE, dst, var.index);
+            break;
+        }
+        case Expr::FUNC:
+            call(expr, dst);
+            break;
+        case Expr::BUILTIN_FUNC:
+            builtin(expr, dst);
+            break;
+        case Expr::MATH_FUNC:
+            math(expr, dst);
+            break;
+        case Expr::PRE_UNARY_OP:
+            if (expr.op == Expr::INCREMENT || expr.op == Expr::DECREMENT)
+                increment(expr, dst, true);
+            else if (expr.op == Expr::ADD)
+                this->expr(*expr.branches[0], dst);
+            else if (expr.op == Expr::SUB && expr.branches[0]->type == Expr::CONST && expr.branches[0]->is_integer() && integral)
+                load(Expr::convert_integer(int64_t(0 - uint64_t(expr.branches[0]->integer)), expr.value_type), dst);
+            else if (expr.op == Expr::SUB && expr.branches[0]->type == Expr::CONST)
+                load(-expr.branches[0]->number, expr.value_type, dst);
+            else if (expr.op == Expr::SUB)
+                emit(integral ? Instruction::INEG : Instruction::NEG, dst, operand(*expr.branches[0]));
+            else
+                emit(Instruction::NOT, dst, operand(*expr.branches[0]));
+            break;
+        case Expr::POST_UNARY_OP:
+            increment(expr, dst, false);
+            break;
+        case Expr::BINARY_OP: {
+            auto op = expr.op;
+            const auto& left = *expr.branches[0];
+            const auto& right = *expr.branches[1];
+            if (op == Expr::ASSIGN) {
+                int reg = assign(expr);
+                if (reg != dst)
+                    emit(Instruction::MOVE, dst, reg);
+            } else if (op == Expr::AND || op == Expr::OR) {
+                vector<size_t> is_false;
+                branch(expr, false, is_false);
+                emit(Instruction::LOADI, dst, 0, 0, 1);
+                auto end = emit(Instruction::JMP);
+                patch(is_false, here());
+                emit(Instruction::LOADI, dst, 0, 0, 0);
+                patch(end, here());
+            } else if ((op == Expr::ADD || op == Expr::SUB) && right.is_integer() && right.integer >= -INT32_MAX &&
+                       right.integer <= INT32_MAX && (integral || op == Expr::ADD || right.integer != 0)) {
+                // a double x - 0 is x, but x + 0 turns -0.0 into +0.0
+                auto value = int32_t(right.integer);
+                emit(integral ? Instruction::IADDI : Instruction::ADDI, dst, operand(left, dst, nullptr), 0,
+                     op == Expr::ADD ? value : -value);
+            } else if (expr.is_comparison()) {
+                // both operands have the same type
+                bool integer = is_integral_type(left.value_type);
+                int a = operand(left), b = operand(right);
+                if (op == Expr::GT || op == Expr::GE)
+                    swap(a, b);
+                auto code = op == Expr::EQ ? Instruction::EQ : op == Expr::NE ? Instruction::NE
+                          : op == Expr::LT || op == Expr::GT ? Instruction::LT : Instruction::LE;
+                emit(integer ? Instruction::Opcode(code - Instruction::EQ + Instruction::IEQ) : code, dst, a, b);
+            } else {
+                Instruction::Opcode code;
+                switch (op) {
+                    case Expr::ADD: code = integral ? Instruction::IADD : Instruction::ADD; break;
+                    case Expr::SUB: code = integral ? Instruction::ISUB : Instruction::SUB; break;
+                    case Expr::MUL: code = integral ? Instruction::IMUL : Instruction::MUL; break;
+                    case Expr::DIV: code = integral ? Instruction::IDIV : Instruction::DIV; break;
+                    case Expr::MOD: code = integral ? Instruction::IMOD : Instruction::MOD; break;
+                    case Expr::POW: code = Instruction::POW; break;
+                    default: throw runtime_error("Compiler: Unsupported operator " + string(expr.value));
+                }
+                int a = operand(left, dst, &right);
+                emit(code, dst, a, operand(right));
+            }
+            break;
+        }
+    }
+    top = saved;
+}
+
+
+void Compiler::effect(const Expr& expr) {
+    auto saved = top;
+    if (expr.type == Expr::BINARY_OP && expr.op == Expr::ASSIGN)
+        assign(expr);
+    else if (expr.op == Expr::INCREMENT || expr.op == Expr::DECREMENT)
+        increment(expr, -1, true);
+    else if (expr.type == Expr::BUILTIN_FUNC)
+        builtin(expr, -1);
+    else if (expr.type == Expr::FUNC)
+        call(expr, -1);
+    else
+        this->expr(expr, temp());
+    top = saved;
+}
+
+
+int Compiler::assign(const Expr& expr) {
+    const auto& left = *expr.branches[0];
+    const auto& right = *expr.branches[1];
+    if (left.type != Expr::VAR)
+        throw runtime_error("Compiler: Only variables can be assigned to");
+    auto var = variable(left.binding);
+    if (!var.global) {
+        this->expr(right, var.index);
+        return var.index;
+    }
+    int reg = temp();
+    this->expr(right, reg);
+    emit(Instruction::SETGLOBAL, reg, 0, 0, var.index);
+    return reg;
+}
+
+
+void Compiler::increment(const Expr& expr, const int& dst, const bool& prefix) {
+    const auto& target = *expr.branches[0];
+    if (target.type != Expr::VAR)
+        throw runtime_error("Compiler: Only variables can be incremented");
+    auto var = variable(target.binding);
+    int step = expr.op == Expr::INCREMENT ? 1 : -1;
+    int reg = var.index;
+    if (var.global) {
+        reg = temp();
+        emit(Instruction::GETGLOBAL, reg, 0, 0, var.index);
+    }
+    if (!prefix && dst >= 0)
+        emit(Instruction::MOVE, dst, reg);
+    emit(is_integral_type(var.type) ? Instruction::IADDI : Instruction::ADDI, reg, reg, 0, step);
+    if (var.type == DataType::CHAR || var.type == DataType::BOOL)
+        convert(reg, reg, DataType::INT, var.type);
+    if (var.global)
+        emit(Instruction::SETGLOBAL, reg, 0, 0, var.index);
+    if (prefix && dst >= 0 && dst != reg)
+        emit(Instruction::MOVE, dst, reg);
+}
+
+
+void Compiler::store(const Variable& var, const int& reg, const DataType& from) {
+    if (!var.global) {
+        convert(var.index, reg, from, var.type);
+        return;
+    }
+    int value = reg;
+    if (from != var.type) {
+        value = temp();
+        convert(value, reg, from, var.type);
+    }
+    emit(Instruction::SETGLOBAL, value, 0, 0, var.index);
+}
+
+
+void Compiler::call(const Expr& expr, const int& dst) {
+    auto found = function_index.find(expr.symbol);
+    if (found == function_index.end()) {
+        if (name(expr.symbol) == "printf")
+            return printf_call(expr, dst);
+        throw runtime_error("Compiler: Undeclared function " + name(expr.symbol));
+    }
+    const auto& signature = signatures[found->second];
+    if (!signature.defined)
+        throw runtime_error("Compiler: Function " + name(expr.symbol) + " is declared but never defined");
+    const auto& args = signature.prot->args;
+    if (expr.branches.size() > args.size())
+        throw runtime_error("Compiler: Too many arguments to " + name(expr.symbol));
+
+    // Arguments are evaluated straight into the callee's frame, which starts at base.
+    int base = temp();
+    for (size_t i = 0; i < args.size(); i++) {
+        int reg = i == 0 ? base : temp();
+        const Expr* arg = i < expr.branches.size() ? expr.branches[i].get() : args[i]->value.get();
+        if (!arg)
+            throw runtime_error("Compiler: Too few arguments to " + name(expr.symbol));
+        this->expr(*arg, reg);
+    }
+    emit(Instruction::CALL, base, 0, 0, found->second);
+    if (dst >= 0 && dst != base)
+        emit(Instruction::MOVE, dst, base);
+}
+
+
+void Compiler::printf_call(const Expr& expr, const int& dst) {
+    if (expr.branches.empty() || expr.branches[0]->type != Expr::STRING)
+        throw runtime_error("Compiler: printf expects a string literal format");
+    if (expr.branches.size() > UINT8_MAX)
+        throw runtime_error("Compiler: Too many arguments to printf");
+    int base = temp();
+    for (size_t i = 1; i < expr.branches.size(); i++)
+        this->expr(*expr.branches[i], i == 1 ? base : temp());
+    emit(Instruction::PRINTF, base, 0, expr.branches.size() - 1, string_constant(unescape(expr.branches[0]->value)));
+    if (dst >= 0 && dst != base)
+        emit(Instruction::MOVE, dst, base);
+}
+
+
+void Compiler::builtin(const Expr& expr, const int& dst) {
+    const auto& args = expr.branches;
+    if (expr.op == Expr::PRINT) {
+        for (size_t i = 0; i < args.size(); i++) {
+            if (i)
+                emit(Instruction::PUTS, 0, 0, 0, string_constant(" "));
+            if (args[i]->type == Expr::STRING)
+                emit(Instruction::PUTS, 0, 0, 0, string_constant(unescape(args[i]->value)));
+            else
+                emit(is_integral_type(args[i]->value_type) ? Instruction::PUTI : Instruction::PUTN, operand(*args[i]));
+        }
+        emit(Instruction::PUTS, 0, 0, 0, string_constant("\n"));
+        if (dst >= 0)
+            emit(Instruction::LOADI, dst);
+        return;
+    }
+
+    int target = dst >= 0 ? dst : temp();
+    if (expr.op == Expr::READ) {
+        if (args.size() > 1)
+            throw runtime_error("Compiler: read expects at most one argument");
+        emit(Instruction::READ, target);
+        if (!args.empty()) {
+            if (args[0]->type != Expr::VAR)
+                throw runtime_error("Compiler: read can only store into a variable");
+            store(variable(args[0]->binding), target, DataType::DOUBLE);
+        }
+        return;
+    }
+    if (args.size() != 1)
+        throw runtime_error("Compiler: " + string(expr.value) + " expects one argument");
+    bool integral = is_integral_type(args[0]->value_type);
+    auto code = expr.op == Expr::ABS ? (integral ? Instruction::IABS : Instruction::ABS) : (integral ? Instruction::ISGN : Instruction::SGN);
+    emit(code, target, operand(*args[0]));
+}
+
+
+void Compiler::math(const Expr& expr, const int& dst) {
+    const auto& args = expr.branches;
+    if (expr.op == Expr::POW) {
+        if (args.size() != 2)
+            throw runtime_error("Compiler: pow expects two arguments");
+        int a = operand(*args[0]);
+        emit(Instruction::POW, dst, a, operand(*args[1]));
+        return;
+    }
+    if (args.size() != 1)
+        throw runtime_error("Compiler: " + string(expr.value) + " expects one argument");
+    auto code = expr.op == Expr::SIN ? Instruction::SIN : expr.op == Expr::COS ? Instruction::COS
+              : expr.op == Expr::EXP ? Instruction::EXP : Instruction::LOG;
+    emit(code, dst, operand(*args[0]));
+}
+
+
+void Compiler::branch(const Expr& expr, const bool& when, vector<size_t>& jumps) {
+    auto saved = top;
+    if (expr.type == Expr::BINARY_OP && expr.is_comparison()) {
+        bool integer = is_integral_type(expr.branches[0]->value_type);
+        int a = operand(*expr.branches[0]), b = operand(*expr.branches[1]);
+        if (expr.op == Expr::GT || expr.op == Expr::GE)
+            swap(a, b);
+        auto code = expr.op == Expr::EQ ? Instruction::JEQ : expr.op == Expr::NE ? Instruction::JNE
+                  : expr.op == Expr::LT || expr.op == Expr::GT ? Instruction::JLT : Instruction::JLE;
+        if (integer)
+            code = Instruction::Opcode(code - Instruction::JEQ + Instruction::IJEQ);
+        jumps.push_back(emit(code, a, b, when));
+    } else if (expr.type == Expr::BINARY_OP && (expr.op == Expr::AND || expr.op == Expr::OR)) {
+        // "a && b" is false as soon as a is; "a || b" is true as soon as a is
+        bool shortcut = expr.op == Expr::OR;
+        if (when == shortcut) {
+            branch(*expr.branches[0], when, jumps);
+            branch(*expr.branches[1], when, jumps);
+        } else {
+            vector<size_t> skip;
+            branch(*expr.branches[0], shortcut, skip);
+            branch(*expr.branches[1], when, jumps);
+            patch(skip, here());
+        }
+    } else if (expr.type == Expr::PRE_UNARY_OP && expr.op == Expr::NOT) {
+        branch(*expr.branches[0], !when, jumps);
+    } else if (expr.type == Expr::CONST) {
+        if ((expr.number != 0) == when)
+            jumps.push_back(emit(Instruction::JMP));
+    } else if (expr.type == Expr::CAST && expr.value_type == DataType::BOOL && is_integral_type(expr.branches[0]->value_type)) {
+        jumps.push_back(emit(Instruction::JT, operand(*expr.branches[0]), 0, when)); // JT already tests for non-zero
+    } else {
+        jumps.push_back(emit(Instruction::JT, operand(expr), 0, when));
+    }
+    top = saved;
+}
+
+
+void Compiler::conditional(const vector<const Conditional*>& chain) {
+    if (chain[0]->type != Conditional::IF)
+        throw runtime_error("Compiler: elif or else without if");
+    vector<size_t> ends;
+    for (size_t i = 0; i < chain.size(); i++) {
+        vector<size_t> next;
+        mark(*chain[i]);
+        if (chain[i]->condition)
+            branch(*chain[i]->condition, false, next);
+        chain[i]->block->accept(*this);
+        if (i + 1 < chain.size())
+            ends.push_back(emit(Instruction::JMP));
+        patch(next, here());
+    }
+    patch(ends, here());
+}
+
+
+void Compiler::visit(const AST& root) {
+    // Functions may be called before their definition, so signatures are collected first.
+    vector<Symbol> names;
+    for (auto& it : root.declarations) {
+        if (it->type != Node::FUNCDECL)
+            continue;
+        auto declaration = static_cast<const FuncDeclaration*>(it.get());
+        bool definition = declaration->type == FuncDeclaration::DEF;
+        auto prot = definition ? static_cast<const FuncDef*>(declaration)->prot.get() : static_cast<const FuncProt*>(declaration);
+        if (prot->args.size() > UINT8_MAX)
+            throw runtime_error("Compiler: Function " + name(prot->func_name) + " has more than 255 parameters");
+
+        auto [found, inserted] = function_index.try_emplace(prot->func_name, signatures.size());
+        if (inserted) {
+            Signature signature{value_type(prot->return_type), {}, prot};
+            for (auto& arg : prot->args)
+                signature.args.push_back(value_type(arg->datatype));
+            signatures.push_back(move(signature));
+            names.push_back(prot->func_name);
+        } else if (signatures[found->second].args.size() != prot->args.size())
+            throw runtime_error("Compiler: Conflicting declarations of " + name(prot->func_name));
+
+        auto& signature = signatures[found->second];
+        if (definition) {
+            if (signature.defined)
+                throw runtime_error("Compiler: Redefinition of " + name(prot->func_name));
+            signature.defined = true;
+        }
+    }
+
+    auto main = function_index.find(SymbolTable::MAIN);
+    if (main == function_index.end() || !signatures[main->second].defined)
+        throw runtime_error("Compiler: No main function");
+    if (!signatures[main->second].args.empty())
+        throw runtime_error("Compiler: main cannot take parameters");
+
+    program.functions.resize(signatures.size() + 1);
+    for (size_t i = 0; i < signatures.size(); i++) {
+        program.functions[i].name = names[i];
+        program.functions[i].arity = signatures[i].args.size();
+    }
+    program.init = signatures.size();
+    program.entry = main->second;
+    program.functions[program.init].name = SymbolTable::none;
+
+    for (auto& it : root.declarations)
+        it->accept(*this);
+
+    function = &program.functions[program.init];
+    emit(Instruction::RET0);
+    function = nullptr;
+}
+
+
+void Compiler::visit(const VarDeclaration& var) {
+    auto type = value_type(var.datatype);
+    if (type == DataType::VOID)
+        throw runtime_error("Compiler: Variable " + name(var.var_name) + " declared void");
+
+    if (function) {
+        top = var.binding.slot; // the live locals occupy exactly the slots below it
+        int reg = temp();
+        if (var.value)
+            expr(*var.value, reg);
+        else
+            emit(Instruction::LOADI, reg);
+        local_types[reg] = type;
+        return;
+    }
+
+    // Globals start out zeroed; initializers run in order in the init function.
+    if (global_types.size() <= var.binding.slot)
+        global_types.resize(var.binding.slot + 1, DataType::DOUBLE);
+    global_types[var.binding.slot] = type;
+    program.globals = global_types.size();
+    if (var.value) {
+        function = &program.functions[program.init];
+        mark(static_cast<const Declaration&>(var));
+        top = 0;
+        int reg = temp();
+        expr(*var.value, reg);
+        store(variable(var.binding), reg, var.value->value_type);
+        function = nullptr;
+    }
+}
+
+
+void Compiler::visit(const FuncProt&) {}
+
+
+void Compiler::visit(const FuncDef& def) {
+    auto index = function_index.at(def.prot->func_name);
+    function = &program.functions[index];
+    return_type = signatures[index].return_type;
+    top = 0;
+    local_types.assign(def.frame_size, DataType::DOUBLE);
+    for (size_t i = 0; i < def.prot->args.size(); i++)
+        local_types[temp()] = signatures[index].args[i];
+
+    def.block->accept(*this);
+    emit(Instruction::RET0); // falling off the end; jumps may target it
+    function = nullptr;
+}
+
+
+void Compiler::visit(const Block& block) {
+    auto saved = top;
+    const auto& statements = block.statements;
+    for (size_t i = 0; i < statements.size();) {
+        if (statements[i]->type != Node::CONDITIONAL) {
+            mark(*statements[i]);
+            statements[i++]->accept(*this);
+            continue;
+        }
+        vector<const Conditional*> chain{static_cast<const Conditional*>(statements[i++].get())};
+        while (chain.back()->type != Conditional::ELSE && i < statements.size() && statements[i]->type == Node::CONDITIONAL &&
+               static_cast<const Conditional*>(statements[i].get())->type != Conditional::IF)
+            chain.push_back(static_cast<const Conditional*>(statements[i++].get()));
+        conditional(chain);
+    }
+    top = saved;
+}
+
+
+void Compiler::visit(const Expr& expr) {
+    effect(expr);
+}
+
+
+void Compiler::visit(const Conditional& cond) {
+    conditional({&cond});
+}
+
+
+void Compiler::visit(const Loop& loop) {
+    // while (c) { body } runs as: jump to the test; body; test: jump back to body if c
+    auto entry = emit(Instruction::JMP);
+    auto body = here();
+    loops.emplace_back();
+    loop.block->accept(*this);
+    patch(loops.back().continues, here());
+    patch(entry, here());
+    mark(loop);
+    vector<size_t> repeat;
+    branch(*loop.condition, true, repeat);
+    patch(repeat, body);
+    patch(loops.back().breaks, here());
+    loops.pop_back();
+}
+
+
+void Compiler::visit(const Return& ret) {
+    auto saved = top;
+    if (return_type == DataType::VOID || !ret.ret_expr) {
+        if (ret.ret_expr)
+            effect(*ret.ret_expr);
+        emit(Instruction::RET0);
+        return;
+    }
+    int reg = operand(*ret.ret_expr);
+    if (return_type == DataType::DOUBLE && function == &program.functions[program.entry]) {
+        int converted = temp(); // VM::run returns main's result as an int
+        convert(converted, reg, DataType::DOUBLE, DataType::INT);
+        reg = converted;
+    }
+    emit(Instruction::RET, reg);
+    top = saved;
+}
+
+
+void Compiler::visit(const Jump& jump) {
+    if (loops.empty())
+        throw runtime_error(string("Compiler: ") + (jump.type == Jump::BREAK ? "break" : "continue") + " outside of a loop");
+    auto& labels = jump.type == Jump::BREAK ? loops.back().breaks : loops.back().continues;
+    labels.push_back(emit(Instruction::JMP));
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+
+#include <unordered_map>
+#include "bytecode.hpp"
+#include "../visitor.hpp"
+
+
+// Translates an AST into register bytecode. Locals live in the registers named
+// by their Resolver slot, temporaries are allocated above them like a stack.
+// The TypeChecker runs first, so every Expr carries its type and conversions
+// are explicit CAST nodes; integral values use the int64 opcodes.
+class Compiler : public ConstVisitor {
+public:
+    // Type checks the AST in place, inserting conversions.
+    static Program compile(AST&);
+    // compile() for an AST that TypeChecker::check has already typed.
+    static Program generate(const AST&);
+
+private:
+    struct Variable {
+        DataType type;
+        bool global;
+        uint32_t index; // register or global slot
+    };
+
+    struct Signature {
+        DataType return_type;
+        vector<DataType> args;
+        const FuncProt* prot;
+        bool defined = false;
+    };
+
+    struct LoopLabels {
+        vector<size_t> breaks;
+        vector<size_t> continues;
+    };
+
+    Program& program;
+    unordered_map<Symbol, uint32_t> function_index;
+    vector<Signature> signatures;
+    vector<DataType> global_types;
+    vector<DataType> local_types; // by frame slot, which is also the variable's register
+    vector<LoopLabels> loops;
+    unordered_map<uint64_t, uint32_t> constant_index; // by bit pattern
+    unordered_map<int64_t, uint32_t> integer_index;
+    unordered_map<string, uint32_t> string_index;
+    Function* function = nullptr;
+    DataType return_type = DataType::VOID;
+    int top = 0; // first free register
+
+    Compiler(Program&);
+
+    static DataType value_type(const string_view&);
+    const string& name(const Symbol&) const;
+
+    size_t emit(const Instruction::Opcode&, const int& a = 0, const int& b = 0, const int& c = 0, const int32_t& d = 0);
+    size_t here() const;
+    void mark(const Node&);
+    void patch(const size_t&, const size_t&);
+    void patch(const vector<size_t>&, const size_t&);
+    int temp();
+    uint32_t constant(const double&);
+    uint32_t integer(const int64_t&);
+    uint32_t string_constant(const string_view&);
+    Variable variable(const Binding&) const;
+
+    static const Expr& skip_widening(const Expr&);
+    void convert(const int&, const int&, const DataType&, const DataType&);
+    void load(const double&, const DataType&, const int&);
+    void load(const int64_t&, const int&);
+    void load(const Expr&, const DataType&, const int&);
+    void expr(const Expr&, const int&);
+    int operand(const Expr&);
+    int operand(const Expr&, const int& dst, const Expr* later);
+    bool uses(const Expr&, const uint8_t&) const;
+    void effect(const Expr&);
+    int assign(const Expr&);
+    void increment(const Expr&, const int&, const bool&);
+    void store(const Variable&, const int&, const DataType&);
+    void call(const Expr&, const int&);
+    void printf_call(const Expr&, const int&);
+    void builtin(const Expr&, const int&);
+    void math(const Expr&, const int&);
+    void branch(const Expr&, const bool&, vector<size_t>&);
+    void conditional(const vector<const Conditional*>&);
+
+public:
+    virtual void visit(const AST&) override;
+    virtual void visit(const VarDeclaration&) override;
+    virtual void visit(const FuncProt&) override;
+    virtual void visit(const FuncDef&) override;
+    virtual void visit(const Block&) override;
+    virtual void visit(const Expr&) override;
+    virtual void visit(const Conditional&) override;
+    virtual void visit(const Loop&) override;
+    virtual void visit(const Return&) override;
+    virtual void visit(const Jump&) override;
+};
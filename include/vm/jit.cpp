@@ -0,0 +1,356 @@
+#include "jit.hpp"
+#include "perf_map.hpp"
+#include <cstring>
+#include <unordered_map>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_X86_64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+double interpret(const Expr* expr, double x) {
+    return expr->eval(x);
+}
+
+typedef double (*Unary)(double);
+typedef double (*Binary)(double, double);
+
+}
+
+
+// Emits SysV x86-64 code. The value of a node is left in xmm0; x and the
+// spilled left operands of binary nodes live in the frame below rbp, and
+// constants in a pool after the code, addressed RIP-relative.
+class JitFunction::Assembler {
+public:
+    vector<uint8_t> code;
+
+    static bool supported(const Expr& expr) {
+        switch (expr.type) {
+            case Expr::CONST:
+            case Expr::CHAR:
+            case Expr::VAR:
+                break;
+            case Expr::PRE_UNARY_OP:
+                if (expr.op != Expr::ADD && expr.op != Expr::SUB && expr.op != Expr::NOT)
+                    return false;
+                break;
+            case Expr::BINARY_OP:
+                if (expr.op < Expr::ADD || expr.op > Expr::OR || expr.op == Expr::NOT)
+                    return false;
+                if ((expr.op == Expr::DIV || expr.op == Expr::MOD) && is_integral_type(expr.value_type))
+                    return false; // truncates and throws on zero
+                break;
+            case Expr::MATH_FUNC:
+                if (expr.branches.size() != (expr.op == Expr::POW ? 2u : 1u) ||
+                    (expr.op != Expr::POW && expr.op != Expr::SIN && expr.op != Expr::COS && expr.op != Expr::EXP &&
+                     expr.op != Expr::LOG))
+                    return false;
+                break;
+            default:
+                return false;
+        }
+        return all_of(expr.branches.begin(), expr.branches.end(), [](const auto& it) { return supported(*it); });
+    }
+
+    void function(const Expr& expr) {
+        emit({0x55});                   // push rbp
+        emit({0x48, 0x89, 0xE5});       // mov rbp, rsp
+        emit({0x48, 0x81, 0xEC});       // sub rsp, imm32
+        size_t frame_at = code.size();
+        emit32(0);
+        movsd_store(x_slot, 0);
+
+        generate(expr, 0);
+
+        emit({0xC9, 0xC3});             // leave; ret
+        int32_t frame = (8 + 8 * slots + 15) & ~15; // keeps rsp 16-aligned at calls
+        memcpy(&code[frame_at], &frame, 4);
+        place_constants();
+    }
+
+    // mov rdi, expr; mov rax, interpret; jmp rax
+    void fallback(const Expr& expr) {
+        emit({0x48, 0xBF});
+        emit64(reinterpret_cast<uint64_t>(&expr));
+        emit({0x48, 0xB8});
+        emit64(reinterpret_cast<uint64_t>(&interpret));
+        emit({0xFF, 0xE0});
+    }
+
+private:
+    enum Prefix : uint8_t { PD = 0x66, SD = 0xF2 };
+    enum SSE : uint8_t { MOV_LOAD = 0x10, MOV_STORE = 0x11, MOVAPD = 0x28, ANDPD = 0x54, ORPD = 0x56, XORPD = 0x57,
+                         ADDSD = 0x58, MULSD = 0x59, SUBSD = 0x5C, DIVSD = 0x5E, CMPSD = 0xC2 };
+    enum Predicate : uint8_t { CMP_EQ = 0, CMP_LT = 1, CMP_LE = 2, CMP_NE = 4 };
+
+    static const int32_t x_slot = -8;
+
+    struct Fixup {
+        size_t at; // disp32 offset in code
+        uint32_t constant;
+    };
+
+    vector<double> constants;
+    unordered_map<uint64_t, uint32_t> constant_index; // by bit pattern
+    vector<Fixup> fixups;
+    int slots = 0;
+
+    static int32_t slot(const int& depth) {
+        return x_slot - 8 * (depth + 1);
+    }
+
+    void emit(initializer_list<uint8_t> bytes) {
+        for (auto it : bytes)
+            code.push_back(it);
+    }
+
+    void emit32(const uint32_t& value) {
+        for (int shift = 0; shift < 32; shift += 8)
+            code.push_back(uint8_t(value >> shift));
+    }
+
+    void emit64(const uint64_t& value) {
+        for (int shift = 0; shift < 64; shift += 8)
+            code.push_back(uint8_t(value >> shift));
+    }
+
+    void sse(const Prefix& prefix, const SSE& op, const int& reg, const int& rm) {
+        emit({prefix, 0x0F, op, uint8_t(0xC0 | reg << 3 | rm)});
+    }
+
+    void cmpsd(const int& reg, const int& rm, const Predicate& predicate) {
+        sse(SD, CMPSD, reg, rm);
+        emit({predicate});
+    }
+
+    void movsd_load(const int& reg, const int32_t& rbp_offset) {
+        emit({SD, 0x0F, MOV_LOAD, uint8_t(0x85 | reg << 3)});
+        emit32(rbp_offset);
+    }
+
+    void movsd_store(const int32_t& rbp_offset, const int& reg) {
+        emit({SD, 0x0F, MOV_STORE, uint8_t(0x85 | reg << 3)});
+        emit32(rbp_offset);
+    }
+
+    void movsd_constant(const int& reg, const double& value) {
+        uint64_t bits;
+        memcpy(&bits, &value, 8);
+        auto [it, inserted] = constant_index.try_emplace(bits, constants.size());
+        if (inserted)
+            constants.push_back(value);
+        emit({SD, 0x0F, MOV_LOAD, uint8_t(0x05 | reg << 3)});
+        fixups.push_back({code.size(), it->second});
+        emit32(0);
+    }
+
+    void call(const void* target) {
+        emit({0x48, 0xB8});             // mov rax, imm64
+        emit64(reinterpret_cast<uint64_t>(target));
+        emit({0xFF, 0xD0});             // call rax
+    }
+
+    static bool leaf(const Expr& expr) {
+        return expr.type == Expr::CONST || expr.type == Expr::CHAR || expr.type == Expr::VAR;
+    }
+
+    void load_leaf(const int& reg, const Expr& expr) {
+        if (expr.type == Expr::VAR)
+            movsd_load(reg, x_slot);
+        else if (expr.type == Expr::CHAR)
+            movsd_constant(reg, expr.value.empty() ? 0 : expr.value[0]);
+        else
+            movsd_constant(reg, expr.number);
+    }
+
+    // Left operand to xmm0, right operand to xmm1.
+    void operands(const Expr& left, const Expr& right, const int& depth) {
+        if (leaf(right)) {
+            generate(left, depth);
+            load_leaf(1, right);
+        } else if (leaf(left)) {
+            generate(right, depth);
+            sse(PD, MOVAPD, 1, 0);
+            load_leaf(0, left);
+        } else {
+            generate(left, depth);
+            slots = max(slots, depth + 1);
+            movsd_store(slot(depth), 0);
+            generate(right, depth + 1);
+            sse(PD, MOVAPD, 1, 0);
+            movsd_load(0, slot(depth));
+        }
+    }
+
+    // xmm0 = mask in xmm0 ? 1.0 : 0.0
+    void mask_to_number() {
+        movsd_constant(1, 1.0);
+        sse(PD, ANDPD, 0, 1);
+    }
+
+    void compare(const Predicate& predicate, const bool& swapped) {
+        if (swapped) {
+            cmpsd(1, 0, predicate);
+            sse(PD, MOVAPD, 0, 1);
+        } else
+            cmpsd(0, 1, predicate);
+        mask_to_number();
+    }
+
+    void generate(const Expr& expr, const int& depth) {
+        switch (expr.type) {
+            case Expr::CONST:
+            case Expr::CHAR:
+            case Expr::VAR:
+                load_leaf(0, expr);
+                return;
+
+            case Expr::PRE_UNARY_OP:
+                generate(*expr.branches[0], depth);
+                if (expr.op == Expr::SUB) {
+                    movsd_constant(1, -0.0);
+                    sse(PD, XORPD, 0, 1);
+                } else if (expr.op == Expr::NOT) {
+                    sse(PD, XORPD, 1, 1);
+                    cmpsd(0, 1, CMP_EQ);
+                    mask_to_number();
+                }
+                return;
+
+            case Expr::BINARY_OP:
+                operands(*expr.branches[0], *expr.branches[1], depth);
+                switch (expr.op) {
+                    case Expr::ADD: sse(SD, ADDSD, 0, 1); return;
+                    case Expr::SUB: sse(SD, SUBSD, 0, 1); return;
+                    case Expr::MUL: sse(SD, MULSD, 0, 1); return;
+                    case Expr::DIV: sse(SD, DIVSD, 0, 1); return;
+                    case Expr::MOD: call(reinterpret_cast<const void*>(static_cast<Binary>(fmod))); return;
+                    case Expr::POW: call(reinterpret_cast<const void*>(static_cast<Binary>(pow))); return;
+                    case Expr::EQ: compare(CMP_EQ, false); return;
+                    case Expr::NE: compare(CMP_NE, false); return;
+                    case Expr::LT: compare(CMP_LT, false); return;
+                    case Expr::LE: compare(CMP_LE, false); return;
+                    case Expr::GT: compare(CMP_LT, true); return;
+                    case Expr::GE: compare(CMP_LE, true); return;
+                    case Expr::AND:
+                    case Expr::OR:
+                        sse(PD, XORPD, 2, 2);
+                        cmpsd(0, 2, CMP_NE);
+                        cmpsd(1, 2, CMP_NE);
+                        sse(PD, expr.op == Expr::AND ? ANDPD : ORPD, 0, 1);
+                        mask_to_number();
+                        return;
+                    default:
+                        break;
+                }
+                break;
+
+            case Expr::MATH_FUNC:
+                if (expr.op == Expr::POW) {
+                    operands(*expr.branches[0], *expr.branches[1], depth);
+                    call(reinterpret_cast<const void*>(static_cast<Binary>(pow)));
+                    return;
+                }
+                generate(*expr.branches[0], depth);
+                switch (expr.op) {
+                    case Expr::SIN: call(reinterpret_cast<const void*>(static_cast<Unary>(sin))); return;
+                    case Expr::COS: call(reinterpret_cast<const void*>(static_cast<Unary>(cos))); return;
+                    case Expr::EXP: call(reinterpret_cast<const void*>(static_cast<Unary>(exp))); return;
+                    case Expr::LOG: call(reinterpret_cast<const void*>(static_cast<Unary>(log))); return;
+                    default: break;
+                }
+                break;
+
+            default:
+                break;
+        }
+        throw logic_error("JitFunction: Unsupported node " + string(expr.value)); // filtered by supported()
+    }
+
+    void place_constants() {
+        code.resize((code.size() + 15) & ~size_t(15), 0xCC); // int3 padding
+        size_t pool = code.size();
+        for (auto& it : fixups) {
+            int32_t displacement = int32_t(pool + 8 * it.constant - (it.at + 4));
+            memcpy(&code[it.at], &displacement, 4);
+        }
+        for (auto value : constants) {
+            uint64_t bits;
+            memcpy(&bits, &value, 8);
+            emit64(bits);
+        }
+    }
+};
+
+
+JitFunction JitFunction::compile(const Expr& expr, const string_view& name) {
+#ifdef JIT_X86_64
+    Assembler assembler;
+    bool native = Assembler::supported(expr);
+    if (native)
+        assembler.function(expr);
+    else
+        assembler.fallback(expr);
+    return JitFunction(assembler.code, native, name);
+#else
+    (void)expr, (void)name;
+    throw runtime_error("JitFunction: Native code needs Linux on x86-64");
+#endif
+}
+
+
+JitFunction::JitFunction(const vector<uint8_t>& code, const bool& native, const string_view& name) : is_native(native) {
+#ifdef JIT_X86_64
+    size_t page = sysconf(_SC_PAGESIZE);
+    size = (code.size() + page - 1) / page * page;
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        memory = nullptr;
+        throw runtime_error("JitFunction: Cannot map memory for code");
+    }
+    memcpy(memory, code.data(), code.size());
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        memory = nullptr;
+        throw runtime_error("JitFunction: Cannot make code executable");
+    }
+    entry = reinterpret_cast<Pointer>(memory);
+    PerfMap::add(memory, code.size(), "proglang:jit:" + string(name));
+#else
+    (void)code, (void)name;
+#endif
+}
+
+
+JitFunction::JitFunction(JitFunction&& other) noexcept
+    : memory(exchange(other.memory, nullptr)),
+      size(exchange(other.size, 0)),
+      entry(exchange(other.entry, nullptr)),
+      is_native(other.is_native) {}
+
+
+JitFunction& JitFunction::operator=(JitFunction&& other) noexcept {
+    if (this != &other) {
+        this->~JitFunction();
+        memory = exchange(other.memory, nullptr);
+        size = exchange(other.size, 0);
+        entry = exchange(other.entry, nullptr);
+        is_native = other.is_native;
+    }
+    return *this;
+}
+
+
+JitFunction::~JitFunction() {
+#ifdef JIT_X86_64
+    if (memory)
+        munmap(memory, size);
+#endif
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+
+#include "../syntaxer/tree.hpp"
+
+
+// Native x86-64 code for an Expr of one variable x, callable as a plain
+// double(*)(double). CONST, CHAR, VAR, PRE_UNARY_OP, BINARY_OP and MATH_FUNC
+// are compiled with SSE2 scalar instructions and direct libm calls; a tree with
+// any other node gets a stub that tail-calls Expr::eval instead, so the result
+// (or the error) is always the interpreter's. The Expr must outlive the code.
+class JitFunction {
+public:
+    typedef double (*Pointer)(double);
+
+    // Linux on x86-64 only; elsewhere this throws runtime_error. The code is
+    // listed in the PerfMap as "proglang:jit:<name>" when that is enabled.
+    static JitFunction compile(const Expr&, const string_view& name = "expr");
+
+    JitFunction(JitFunction&&) noexcept;
+    JitFunction& operator=(JitFunction&&) noexcept;
+    ~JitFunction();
+
+    Pointer function() const { return entry; }
+    double operator()(const double& x) const { return entry(x); }
+    // false when the code is the Expr::eval fallback stub
+    bool native() const { return is_native; }
+
+private:
+    void* memory = nullptr;
+    size_t size = 0;
+    Pointer entry = nullptr;
+    bool is_native = false;
+
+    JitFunction() = default;
+    JitFunction(const vector<uint8_t>&, const bool&, const string_view&);
+
+    class Assembler;
+};
@@ -0,0 +1,101 @@
+#include "perf_map.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) && defined(__linux__)
+#define PERF_MAP_TRAMPOLINES
+#include <sys/mman.h>
+#endif
+
+
+namespace {
+
+
+atomic<bool> forced{false};
+mutex map_lock;
+FILE* file = nullptr; // opened on the first entry, under map_lock
+unordered_map<string, PerfMap::Trampoline> trampolines; // under map_lock
+
+
+// Appends one entry; map_lock must be held.
+void write_entry(const void* start, const size_t& size, const string_view& name) {
+#if defined(__linux__)
+    if (!file) {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/perf-%d.map", int(getpid()));
+        file = fopen(path, "a");
+        if (!file)
+            return;
+    }
+    fprintf(file, "%llx %zx %.*s\n", static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(start)), size,
+            int(name.size()), name.data());
+    fflush(file); // a profiler may read the map while the process still runs
+#else
+    (void)start, (void)size, (void)name;
+#endif
+}
+
+
+}
+
+
+bool PerfMap::enabled() {
+    static const bool environment = [] {
+        const char* value = getenv("PROGLANG_PERF_MAP");
+        return value && *value && strcmp(value, "0") != 0;
+    }();
+    return environment || forced.load(memory_order_relaxed);
+}
+
+
+void PerfMap::enable() {
+    forced.store(true, memory_order_relaxed);
+}
+
+
+void PerfMap::add(const void* start, const size_t& size, const string_view& name) {
+    if (!enabled())
+        return;
+    lock_guard<mutex> guard(map_lock);
+    write_entry(start, size, name);
+}
+
+
+PerfMap::Trampoline PerfMap::trampoline(const string& name) {
+#ifdef PERF_MAP_TRAMPOLINES
+    if (!enabled())
+        return nullptr;
+    lock_guard<mutex> guard(map_lock);
+    auto found = trampolines.find(name);
+    if (found != trampolines.end())
+        return found->second;
+
+    // push rbp; mov rbp, rsp; call rdx; pop rbp; ret. The frame pointer lets
+    // perf --call-graph=fp walk through the stub.
+    static const uint8_t code[] = {0x55, 0x48, 0x89, 0xe5, 0xff, 0xd2, 0x5d, 0xc3};
+    size_t size = sysconf(_SC_PAGESIZE);
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return nullptr;
+    memcpy(memory, code, sizeof(code));
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return nullptr;
+    }
+    auto stub = reinterpret_cast<Trampoline>(memory);
+    trampolines.emplace(name, stub);
+    write_entry(memory, sizeof(code), name);
+    return stub;
+#else
+    (void)name;
+    return nullptr;
+#endif
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+
+using namespace std;
+
+
+// /tmp/perf-<pid>.map, the file perf and other profilers read to name native
+// code that no ELF file describes. Nothing is written unless PROGLANG_PERF_MAP
+// is set in the environment or enable() was called; then every piece of
+// generated code is appended as "start size name" when it is created.
+class PerfMap {
+public:
+    typedef uint64_t (*Body)(void*, uint64_t);
+    typedef uint64_t (*Trampoline)(void*, uint64_t, Body);
+
+    static bool enabled();
+    static void enable();
+
+    // Records the code at [start, start + size) under `name`.
+    static void add(const void* start, const size_t& size, const string_view& name);
+
+    // A native stub named `name` that returns body(context, argument). While
+    // body runs, the stub is its caller on the native stack, so a profile
+    // attributes everything body does to `name`: the VM runs each program
+    // through one, named after the program's source. Stubs are made once per
+    // name and live as long as the process. Null when native code is not
+    // supported (Linux on x86-64 only) or the map is disabled.
+    static Trampoline trampoline(const string& name);
+};
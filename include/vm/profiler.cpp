@@ -0,0 +1,131 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <unordered_map>
+#include <unordered_set>
+
+
+Profiler::Profiler(const chrono::microseconds& interval) : period(max(interval, chrono::microseconds(1))) {}
+
+
+Profiler::~Profiler() {
+    stop();
+}
+
+
+void Profiler::start() {
+    if (timer.joinable())
+        return;
+    running = true;
+    timer = thread([this] {
+        unique_lock<mutex> guard(lock);
+        auto next = chrono::steady_clock::now() + period;
+        while (!wake.wait_until(guard, next, [this] { return !running; })) {
+            requested.store(true, memory_order_relaxed);
+            next += period;
+            auto now = chrono::steady_clock::now();
+            if (next < now) // a late wakeup does not turn into a burst of samples
+                next = now + period;
+        }
+    });
+}
+
+
+void Profiler::stop() {
+    if (!timer.joinable())
+        return;
+    {
+        lock_guard<mutex> guard(lock);
+        running = false;
+    }
+    wake.notify_all();
+    timer.join();
+    requested.store(false, memory_order_relaxed);
+}
+
+
+void Profiler::record(span<const Location> stack) {
+    requested.store(false, memory_order_relaxed);
+    key.assign(stack.begin(), stack.end());
+    stacks[key]++; // copies the key only for a new stack
+    total++;
+}
+
+
+void Profiler::clear() {
+    stacks.clear();
+    total = 0;
+}
+
+
+string Profiler::frame_name(const Program& program, const Location& location, const SourceMap* source) const {
+    auto name = program.name(location.function);
+    if (!source)
+        return name;
+    auto line = source->position(program.functions[location.function].offset(location.pc)).line;
+    return line ? name + ":" + to_string(line) : name;
+}
+
+
+void Profiler::write_collapsed(ostream& out, const Program& program, const SourceMap* source) const {
+    // stacks that differ only in pcs of the same lines are merged
+    map<string, uint64_t> lines;
+    for (const auto& [stack, count] : stacks) {
+        string line;
+        for (const auto& location : stack) {
+            if (!line.empty())
+                line += ';';
+            line += frame_name(program, location, source);
+        }
+        lines[line] += count;
+    }
+    for (const auto& [line, count] : lines)
+        out << line << " " << count << "\n";
+    out.flush();
+}
+
+
+void Profiler::write_lines(ostream& out, const Program& program, const SourceMap& source) const {
+    struct Hits {
+        uint32_t function;
+        uint64_t self = 0, total = 0;
+    };
+    unordered_map<uint32_t, Hits> hits; // by source line
+    unordered_set<uint32_t> seen;
+    for (const auto& [stack, count] : stacks) {
+        seen.clear();
+        for (size_t i = 0; i < stack.size(); i++) {
+            auto line = source.position(program.functions[stack[i].function].offset(stack[i].pc)).line;
+            if (!line)
+                continue; // no line table, or one for another source
+            auto& entry = hits.try_emplace(line, Hits{stack[i].function}).first->second;
+            if (i + 1 == stack.size())
+                entry.self += count;
+            if (seen.insert(line).second)
+                entry.total += count;
+        }
+    }
+
+    vector<pair<uint32_t, Hits>> rows(hits.begin(), hits.end());
+    sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+        return tie(b.second.self, b.second.total, a.first) < tie(a.second.self, a.second.total, b.first);
+    });
+
+    auto flags = out.flags();
+    auto precision = out.precision();
+    double scale = total ? 100.0 / total : 0;
+    out << total << " samples every " << period.count() << " us\n";
+    out << setw(6) << "line" << setw(9) << "self" << setw(8) << "%" << setw(9) << "total" << setw(8) << "%"
+        << "  function\n";
+    out << fixed << setprecision(1);
+    for (const auto& [line, entry] : rows) {
+        auto text = source.line(line);
+        text.remove_prefix(min(text.find_first_not_of(" \t"), text.size()));
+        out << setw(6) << line << setw(9) << entry.self << setw(7) << entry.self * scale << "%" << setw(9)
+            << entry.total << setw(7) << entry.total * scale << "%  " << left << setw(12)
+            << program.name(entry.function) << right << "  " << text << "\n";
+    }
+    out.flush();
+    out.flags(flags);
+    out.precision(precision);
+}
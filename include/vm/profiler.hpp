@@ -0,0 +1,70 @@
+#pragma once
+
+
+#include "bytecode.hpp"
+#include "../lexer/source_map.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <span>
+#include <thread>
+
+
+// Statistical profiler for VM::run(Profiler&). A timer thread raises a flag
+// every interval; the VM checks it between instructions and records the call
+// stack at that point. No signals are involved, so the interpreter needs no
+// async-safe code, and between samples the cost is one relaxed load per
+// instruction. Samples accumulate over every run until clear().
+class Profiler {
+public:
+    // An instruction of Program::functions[function], the current one for the
+    // innermost frame and the CALL for its callers.
+    struct Location {
+        uint32_t function;
+        uint32_t pc;
+
+        auto operator<=>(const Location&) const = default;
+    };
+
+    explicit Profiler(const chrono::microseconds& interval = chrono::milliseconds(1));
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+    ~Profiler();
+
+    // Starts and stops the timer thread; VM::run(Profiler&) calls both.
+    void start();
+    void stop();
+
+    bool pending() const { return requested.load(memory_order_relaxed); }
+    // Adds a stack, outermost frame first, and clears the request.
+    void record(span<const Location>);
+
+    uint64_t samples() const { return total; }
+    chrono::microseconds interval() const { return period; }
+    void clear();
+
+    // One line per distinct stack in the collapsed format of flamegraph.pl and
+    // speedscope: "main:12;fib:5;fib:6 42". Frames are named by function and,
+    // given the source, by the line of the sampled instruction.
+    void write_collapsed(ostream&, const Program&, const SourceMap* = nullptr) const;
+    // Samples per source line with the function and text of the line, hottest
+    // first: self counts the innermost frame only, total every frame at most
+    // once per sample. Lines come from the line tables the Compiler emits.
+    void write_lines(ostream&, const Program&, const SourceMap&) const;
+
+private:
+    chrono::microseconds period;
+    atomic<bool> requested{false};
+    map<vector<Location>, uint64_t> stacks;
+    vector<Location> key;
+    uint64_t total = 0;
+
+    thread timer;
+    mutex lock;
+    condition_variable wake;
+    bool running = false;
+
+    string frame_name(const Program&, const Location&, const SourceMap*) const;
+};
@@ -0,0 +1,392 @@
+#include "vm.hpp"
+#include "perf_map.hpp"
+#include "../probes.hpp"
+#include <bit>
+#include <utility>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <charconv>
+
+
+// Threaded dispatch: every handler jumps straight to the next one through a
+// label table instead of returning to a shared switch.
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_COMPUTED_GOTO
+#endif
+
+
+VM::VM(const Program& program, ostream& out, istream& in) : program(program), out(out), in(in), stack(1 << 8) {}
+
+
+int VM::run() {
+    return start<PLAIN>();
+}
+
+
+int VM::run(uint64_t& executed) {
+    this->executed = 0;
+    int result = start<COUNTED>();
+    executed = this->executed;
+    return result;
+}
+
+
+int VM::run(Profiler& profiler) {
+    this->profiler = &profiler;
+    profiler.start();
+    try {
+        int result = start<PROFILED>();
+        profiler.stop();
+        return result;
+    } catch (...) {
+        profiler.stop();
+        throw;
+    }
+}
+
+
+template<VM::Mode mode>
+int VM::start() {
+    globals.assign(program.globals, Value{0});
+    frames.clear();
+    auto stub = PerfMap::trampoline("proglang:" + (program.source_name.empty() ? string("<program>") : program.source_name));
+    auto call = [&](const uint32_t& index) {
+        if (!stub)
+            return execute<mode>(index);
+        auto result = bit_cast<Value>(stub(this, index, &VM::enter<mode>));
+        if (error)
+            rethrow_exception(exchange(error, nullptr));
+        return result;
+    };
+    try {
+        call(program.init);
+        Value result = call(program.entry);
+        flush();
+        return int(result.i);
+    } catch (...) {
+        flush();
+        throw;
+    }
+}
+
+
+// execute() for a PerfMap trampoline, which has no unwind information:
+// exceptions must not pass through it.
+template<VM::Mode mode>
+uint64_t VM::enter(void* context, uint64_t index) {
+    auto vm = static_cast<VM*>(context);
+    try {
+        return bit_cast<uint64_t>(vm->execute<mode>(uint32_t(index)));
+    } catch (...) {
+        vm->error = current_exception();
+        return 0;
+    }
+}
+
+
+// Fires function_entry or function_return for the innermost frame.
+void VM::probe_function(const bool& entry, const Function* function) const {
+    size_t index = function - program.functions.data();
+    auto name = program.name(index);
+    if (entry)
+        USDT_PROBE3(function_entry, index, name.c_str(), frames.size());
+    else
+        USDT_PROBE3(function_return, index, name.c_str(), frames.size());
+}
+
+
+// The stack from the outermost caller down to the instruction at pc; callers
+// are at their CALL instruction.
+void VM::sample(const Function* function, const Instruction* pc) {
+    const Function* functions = program.functions.data();
+    trace.clear();
+    for (const auto& frame : frames)
+        trace.push_back({uint32_t(frame.function - functions), uint32_t(frame.pc - frame.function->code.data() - 1)});
+    trace.push_back({uint32_t(function - functions), uint32_t(pc - function->code.data())});
+    profiler->record(trace);
+}
+
+
+void VM::flush() {
+    out.write(output.data(), output.size());
+    out.flush();
+    output.clear();
+}
+
+
+void VM::print_number(const double& value) {
+    char buffer[32];
+    auto [end, error] = to_chars(buffer, buffer + sizeof(buffer), value);
+    output.append(buffer, end);
+}
+
+
+void VM::print_integer(const int64_t& value) {
+    char buffer[24];
+    auto [end, error] = to_chars(buffer, buffer + sizeof(buffer), value);
+    output.append(buffer, end);
+}
+
+
+// Supports the conversions d i u x X o c f F e E g G a A with flags, width and
+// precision; length modifiers are accepted and ignored since the compiler passes
+// int64 values to the integer conversions and doubles to the others.
+int64_t VM::print_formatted(const string& format, const Value* args, const size_t& count) {
+    size_t written = output.size(), next = 0, size = format.size();
+    for (size_t i = 0; i < size; i++) {
+        if (format[i] != '%') {
+            output += format[i];
+            continue;
+        }
+        if (i + 1 < size && format[i + 1] == '%') {
+            output += '%';
+            i++;
+            continue;
+        }
+
+        auto start = i++;
+        while (i < size && strchr("-+ #0", format[i]))
+            i++;
+        while (i < size && isdigit(static_cast<unsigned char>(format[i])))
+            i++;
+        if (i < size && format[i] == '.') {
+            i++;
+            while (i < size && isdigit(static_cast<unsigned char>(format[i])))
+                i++;
+        }
+        auto spec = format.substr(start, i - start);
+        while (i < size && strchr("hlLqjzt", format[i]))
+            i++;
+        if (i == size) {
+            output.append(format, start);
+            break;
+        }
+
+        char buffer[512];
+        int length = 0;
+        Value value = next < count ? args[next++] : Value{0};
+        switch (format[i]) {
+            case 'd': case 'i':
+                length = snprintf(buffer, sizeof(buffer), (spec + "lld").c_str(), static_cast<long long>(value.i));
+                break;
+            case 'u': case 'x': case 'X': case 'o':
+                length = snprintf(buffer, sizeof(buffer), (spec + "ll" + format[i]).c_str(),
+                                  static_cast<unsigned long long>(value.i));
+                break;
+            case 'c':
+                length = snprintf(buffer, sizeof(buffer), (spec + "c").c_str(), static_cast<int>(value.i));
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                length = snprintf(buffer, sizeof(buffer), (spec + format[i]).c_str(), value.d);
+                break;
+            default:
+                output.append(format, start, i - start + 1);
+                continue;
+        }
+        output.append(buffer, min<size_t>(max(length, 0), sizeof(buffer) - 1));
+    }
+    return output.size() - written;
+}
+
+
+// COUNTED increments `executed` on every dispatch and PROFILED checks for a
+// requested sample; the PLAIN instantiation is the one run() uses and does neither.
+template<VM::Mode mode>
+Value VM::execute(const uint32_t& index) {
+    const Function* function = &program.functions[index];
+    const double* constants = program.constants.data();
+    const int64_t* integers = program.integers.data();
+    Value* globals = this->globals.data();
+    size_t entry_depth = frames.size();
+    if (stack.size() < function->registers)
+        stack.resize(function->registers);
+    Value* R = stack.data();
+    const Instruction* pc = function->code.data();
+    Instruction ins;
+    if (USDT_ENABLED(function_entry))
+        probe_function(true, function);
+
+#define VM_HOOK() do { \
+        if constexpr (mode == COUNTED) \
+            executed++; \
+        if constexpr (mode == PROFILED) \
+            if (profiler->pending()) \
+                sample(function, pc); \
+    } while (0)
+
+#ifdef VM_COMPUTED_GOTO
+    static const void* const labels[] = {
+#define VM_LABEL(name) &&op_##name,
+        BYTECODE_OPCODES(VM_LABEL)
+#undef VM_LABEL
+    };
+#define CASE(name) op_##name:
+#define NEXT() do { VM_HOOK(); ins = *pc++; goto *labels[ins.op]; } while (0)
+    NEXT();
+#else
+#define CASE(name) case Instruction::name:
+#define NEXT() goto dispatch
+dispatch:
+    VM_HOOK();
+    ins = *pc++;
+    switch (ins.op) {
+#endif
+
+    CASE(MOVE) R[ins.a] = R[ins.b]; NEXT();
+    CASE(LOADK) R[ins.a].d = constants[ins.d]; NEXT();
+    CASE(LOADL) R[ins.a].i = integers[ins.d]; NEXT();
+    CASE(LOADI) R[ins.a].i = ins.d; NEXT();
+    CASE(GETGLOBAL) R[ins.a] = globals[ins.d]; NEXT();
+    CASE(SETGLOBAL) globals[ins.d] = R[ins.a]; NEXT();
+
+    CASE(ADD) R[ins.a].d = R[ins.b].d + R[ins.c].d; NEXT();
+    CASE(SUB) R[ins.a].d = R[ins.b].d - R[ins.c].d; NEXT();
+    CASE(MUL) R[ins.a].d = R[ins.b].d * R[ins.c].d; NEXT();
+    CASE(DIV) R[ins.a].d = R[ins.b].d / R[ins.c].d; NEXT();
+    CASE(MOD) R[ins.a].d = fmod(R[ins.b].d, R[ins.c].d); NEXT();
+    CASE(POW) R[ins.a].d = pow(R[ins.b].d, R[ins.c].d); NEXT();
+    CASE(ADDI) R[ins.a].d = R[ins.b].d + ins.d; NEXT();
+
+    // int arithmetic wraps around like the hardware, without signed overflow
+    CASE(IADD) R[ins.a].i = int64_t(uint64_t(R[ins.b].i) + uint64_t(R[ins.c].i)); NEXT();
+    CASE(ISUB) R[ins.a].i = int64_t(uint64_t(R[ins.b].i) - uint64_t(R[ins.c].i)); NEXT();
+    CASE(IMUL) R[ins.a].i = int64_t(uint64_t(R[ins.b].i) * uint64_t(R[ins.c].i)); NEXT();
+    CASE(IDIV)
+        if (R[ins.c].i == 0)
+            throw runtime_error("VM: Integer division by zero");
+        R[ins.a].i = R[ins.c].i == -1 ? int64_t(0 - uint64_t(R[ins.b].i)) : R[ins.b].i / R[ins.c].i;
+        NEXT();
+    CASE(IMOD)
+        if (R[ins.c].i == 0)
+            throw runtime_error("VM: Integer division by zero");
+        R[ins.a].i = R[ins.c].i == -1 ? 0 : R[ins.b].i % R[ins.c].i;
+        NEXT();
+    CASE(IADDI) R[ins.a].i = int64_t(uint64_t(R[ins.b].i) + uint64_t(int64_t(ins.d))); NEXT();
+
+    CASE(EQ) R[ins.a].i = R[ins.b].d == R[ins.c].d; NEXT();
+    CASE(NE) R[ins.a].i = R[ins.b].d != R[ins.c].d; NEXT();
+    CASE(LT) R[ins.a].i = R[ins.b].d < R[ins.c].d; NEXT();
+    CASE(LE) R[ins.a].i = R[ins.b].d <= R[ins.c].d; NEXT();
+    CASE(IEQ) R[ins.a].i = R[ins.b].i == R[ins.c].i; NEXT();
+    CASE(INE) R[ins.a].i = R[ins.b].i != R[ins.c].i; NEXT();
+    CASE(ILT) R[ins.a].i = R[ins.b].i < R[ins.c].i; NEXT();
+    CASE(ILE) R[ins.a].i = R[ins.b].i <= R[ins.c].i; NEXT();
+
+    CASE(NEG) R[ins.a].d = -R[ins.b].d; NEXT();
+    CASE(INEG) R[ins.a].i = int64_t(0 - uint64_t(R[ins.b].i)); NEXT();
+    CASE(NOT) R[ins.a].i = R[ins.b].i == 0; NEXT();
+    CASE(TOINT) {
+        double value = R[ins.b].d;
+        R[ins.a].i = value >= -0x1p63 && value < 0x1p63 ? int64_t(value) : INT64_MIN;
+        NEXT();
+    }
+    CASE(TOCHAR) R[ins.a].i = int8_t(R[ins.b].i); NEXT();
+    CASE(TOBOOL) R[ins.a].i = R[ins.b].d != 0; NEXT();
+    CASE(ITOBOOL) R[ins.a].i = R[ins.b].i != 0; NEXT();
+    CASE(TODOUBLE) R[ins.a].d = double(R[ins.b].i); NEXT();
+    CASE(ABS) R[ins.a].d = fabs(R[ins.b].d); NEXT();
+    CASE(IABS) R[ins.a].i = R[ins.b].i < 0 ? int64_t(0 - uint64_t(R[ins.b].i)) : R[ins.b].i; NEXT();
+    CASE(SGN) R[ins.a].i = (R[ins.b].d > 0) - (R[ins.b].d < 0); NEXT();
+    CASE(ISGN) R[ins.a].i = (R[ins.b].i > 0) - (R[ins.b].i < 0); NEXT();
+    CASE(SIN) R[ins.a].d = sin(R[ins.b].d); NEXT();
+    CASE(COS) R[ins.a].d = cos(R[ins.b].d); NEXT();
+    CASE(EXP) R[ins.a].d = exp(R[ins.b].d); NEXT();
+    CASE(LOG) R[ins.a].d = log(R[ins.b].d); NEXT();
+
+    CASE(JMP) pc += ins.d; NEXT();
+    CASE(JT) if ((R[ins.a].i != 0) == ins.c) pc += ins.d; NEXT();
+    CASE(JEQ) if ((R[ins.a].d == R[ins.b].d) == ins.c) pc += ins.d; NEXT();
+    CASE(JNE) if ((R[ins.a].d != R[ins.b].d) == ins.c) pc += ins.d; NEXT();
+    CASE(JLT) if ((R[ins.a].d < R[ins.b].d) == ins.c) pc += ins.d; NEXT();
+    CASE(JLE) if ((R[ins.a].d <= R[ins.b].d) == ins.c) pc += ins.d; NEXT();
+    CASE(IJEQ) if ((R[ins.a].i == R[ins.b].i) == ins.c) pc += ins.d; NEXT();
+    CASE(IJNE) if ((R[ins.a].i != R[ins.b].i) == ins.c) pc += ins.d; NEXT();
+    CASE(IJLT) if ((R[ins.a].i < R[ins.b].i) == ins.c) pc += ins.d; NEXT();
+    CASE(IJLE) if ((R[ins.a].i <= R[ins.b].i) == ins.c) pc += ins.d; NEXT();
+
+    CASE(CALL) {
+        if (frames.size() - entry_depth >= max_depth)
+            throw runtime_error("VM: Call stack overflow");
+        size_t base = R - stack.data();
+        frames.push_back({function, pc, base});
+        base += ins.a;
+        function = &program.functions[ins.d];
+        if (stack.size() < base + function->registers)
+            stack.resize(max(stack.size() * 2, base + function->registers));
+        R = stack.data() + base;
+        pc = function->code.data();
+        if (USDT_ENABLED(function_entry))
+            probe_function(true, function);
+        NEXT();
+    }
+    CASE(RET)
+        R[0] = R[ins.a]; // the caller's result register
+        goto ret;
+    CASE(RET0)
+        R[0].i = 0;
+        goto ret;
+
+    CASE(READ) {
+        flush();
+        bool read = bool(in >> R[ins.a].d);
+        if (USDT_ENABLED(read))
+            USDT_PROBE1(read, read);
+        if (!read)
+            throw runtime_error("VM: read(): Expected a number on the input");
+        NEXT();
+    }
+    CASE(PUTN) {
+        size_t written = output.size();
+        print_number(R[ins.a].d);
+        if (USDT_ENABLED(print))
+            USDT_PROBE1(print, output.size() - written);
+        if (output.size() > (1 << 16))
+            flush();
+        NEXT();
+    }
+    CASE(PUTI) {
+        size_t written = output.size();
+        print_integer(R[ins.a].i);
+        if (USDT_ENABLED(print))
+            USDT_PROBE1(print, output.size() - written);
+        if (output.size() > (1 << 16))
+            flush();
+        NEXT();
+    }
+    CASE(PUTS)
+        output += program.strings[ins.d];
+        if (USDT_ENABLED(print))
+            USDT_PROBE1(print, program.strings[ins.d].size());
+        if (output.size() > (1 << 16))
+            flush();
+        NEXT();
+    CASE(PRINTF)
+        R[ins.a].i = print_formatted(program.strings[ins.d], R + ins.a, ins.c);
+        if (USDT_ENABLED(printf))
+            USDT_PROBE2(printf, program.strings[ins.d].c_str(), R[ins.a].i);
+        if (output.size() > (1 << 16))
+            flush();
+        NEXT();
+
+ret:
+    if (USDT_ENABLED(function_return))
+        probe_function(false, function);
+    if (frames.size() == entry_depth)
+        return R[0];
+    function = frames.back().function;
+    pc = frames.back().pc;
+    R = stack.data() + frames.back().base;
+    frames.pop_back();
+    NEXT();
+
+#ifndef VM_COMPUTED_GOTO
+    default:
+        throw runtime_error("VM: Invalid opcode " + to_string(ins.op));
+    }
+#endif
+#undef CASE
+#undef NEXT
+#undef VM_HOOK
+    return Value{0};
+}
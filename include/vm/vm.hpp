@@ -0,0 +1,62 @@
+#pragma once
+
+
+#include "bytecode.hpp"
+#include "profiler.hpp"
+#include <exception>
+
+
+// Executes a Program. Registers of all active frames live in one stack; a
+// callee's frame starts at the caller register holding its first argument.
+// All run state is per instance: VMs on different threads share only the
+// Program, which they never modify, and whatever streams they are given.
+// Function calls, print, printf and read fire the probes of probes.hpp; with
+// the PerfMap enabled, programs run below a stub named after their source.
+class VM {
+public:
+    // print and printf write to `out`, read() takes numbers from `in`.
+    VM(const Program&, ostream& = cout, istream& = cin);
+
+    // Runs the global initializers and then main; returns main's result.
+    int run();
+    // Like run(), but also counts the bytecode instructions executed into `executed`.
+    int run(uint64_t& executed);
+    // Like run(), with the profiler sampling the call stack while the program runs.
+    int run(Profiler&);
+
+private:
+    struct Frame {
+        const Function* function;
+        const Instruction* pc;
+        size_t base;
+    };
+
+    // What every dispatch does besides executing: nothing, counting into
+    // `executed`, or taking the stack sample a Profiler asked for.
+    enum Mode { PLAIN, COUNTED, PROFILED };
+
+    static constexpr size_t max_depth = 1 << 16;
+
+    const Program& program;
+    ostream& out;
+    istream& in;
+    vector<Value> stack;
+    vector<Value> globals;
+    vector<Frame> frames;
+    string output; // flushed to out when large, before reads and at exit
+
+    uint64_t executed = 0;
+    Profiler* profiler = nullptr;
+    vector<Profiler::Location> trace; // reused by every sample
+    exception_ptr error; // thrown by execute() under a PerfMap trampoline
+
+    template<Mode> int start();
+    template<Mode> Value execute(const uint32_t&);
+    template<Mode> static uint64_t enter(void*, uint64_t);
+    void probe_function(const bool& entry, const Function*) const;
+    void sample(const Function*, const Instruction*);
+    void flush();
+    void print_number(const double&);
+    void print_integer(const int64_t&);
+    int64_t print_formatted(const string&, const Value*, const size_t&);
+};
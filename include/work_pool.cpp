@@ -0,0 +1,129 @@
+#include "work_pool.hpp"
+#include <utility>
+
+
+WorkPool::WorkPool(const size_t& threads) {
+    size_t count = threads ? threads : max(1u, thread::hardware_concurrency());
+    ranges = make_unique<Range[]>(count);
+    for (size_t i = 1; i < count; i++)
+        workers.emplace_back(&WorkPool::loop, this, i);
+}
+
+
+WorkPool::~WorkPool() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& it : workers)
+        it.join();
+}
+
+
+void WorkPool::run(const size_t& count, const Task& task) {
+    if (!count)
+        return;
+    size_t n = size();
+    {
+        lock_guard<mutex> guard(lock);
+        for (size_t i = 0; i < n; i++) {
+            lock_guard<mutex> range(ranges[i].lock);
+            ranges[i].begin = count * i / n;
+            ranges[i].end = count * (i + 1) / n;
+        }
+        this->task = &task;
+        error = nullptr;
+        running = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    work(0);
+    unique_lock<mutex> guard(lock);
+    finished.wait(guard, [&] { return running == 0; });
+    this->task = nullptr;
+    if (error)
+        rethrow_exception(exchange(error, nullptr));
+}
+
+
+void WorkPool::loop(const size_t& self) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        work(self);
+        lock_guard<mutex> guard(lock);
+        if (--running == 0)
+            finished.notify_one();
+    }
+}
+
+
+void WorkPool::work(const size_t& self) {
+    size_t index;
+    while (next(self, index)) {
+        try {
+            (*task)(index, self);
+        } catch (...) {
+            lock_guard<mutex> guard(lock);
+            if (!error)
+                error = current_exception();
+        }
+    }
+}
+
+
+bool WorkPool::next(const size_t& self, size_t& index) {
+    {
+        lock_guard<mutex> guard(ranges[self].lock);
+        auto& own = ranges[self];
+        if (own.begin < own.end) {
+            index = own.begin++;
+            return true;
+        }
+    }
+    return steal(self, index);
+}
+
+
+// Takes the back half of the fullest other range: the first index stolen runs
+// now and the rest becomes this worker's range, open to thieves in turn.
+bool WorkPool::steal(const size_t& self, size_t& index) {
+    size_t n = size();
+    while (true) {
+        size_t victim = self, most = 0;
+        for (size_t i = 1; i < n; i++) {
+            auto& range = ranges[(self + i) % n];
+            lock_guard<mutex> guard(range.lock);
+            if (range.end - range.begin > most) {
+                most = range.end - range.begin;
+                victim = (self + i) % n;
+            }
+        }
+        if (victim == self)
+            return false;
+
+        size_t begin, end;
+        {
+            auto& range = ranges[victim];
+            lock_guard<mutex> guard(range.lock);
+            if (range.begin >= range.end)
+                continue; // emptied meanwhile; look again
+            begin = range.end - (range.end - range.begin + 1) / 2;
+            end = range.end;
+            range.end = begin;
+        }
+        index = begin;
+        lock_guard<mutex> guard(ranges[self].lock);
+        ranges[self].begin = begin + 1;
+        ranges[self].end = end;
+        return true;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <memory>
+
+
+using namespace std;
+
+
+// Fixed set of worker threads for data-parallel loops. run() hands every
+// worker an equal slice of the index range; a worker that finishes its slice
+// steals the back half of the largest remaining one, so uneven tasks (one huge
+// function among many small ones) still keep all threads busy.
+class WorkPool {
+public:
+    // Called as task(index, worker) with worker in [0, size()); the calling
+    // thread of run() takes part as worker 0.
+    typedef function<void(size_t, size_t)> Task;
+
+    // 0 uses every hardware thread.
+    explicit WorkPool(const size_t& threads = 0);
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+    ~WorkPool();
+
+    size_t size() const { return workers.size() + 1; }
+
+    // Runs task for every index in [0, count) and returns when all are done.
+    // The first exception a task throws is rethrown here once the others finish.
+    void run(const size_t& count, const Task& task);
+
+private:
+    struct alignas(64) Range {
+        mutex lock;
+        size_t begin = 0, end = 0;
+    };
+
+    vector<thread> workers;
+    unique_ptr<Range[]> ranges; // one per worker
+    const Task* task = nullptr;
+
+    mutex lock;
+    condition_variable wake, finished;
+    uint64_t generation = 0;
+    size_t running = 0;
+    bool stopping = false;
+    exception_ptr error;
+
+    void loop(const size_t&);
+    void work(const size_t&);
+    bool next(const size_t&, size_t&);
+    bool steal(const size_t&, size_t&);
+};
@@ -1,9 +1,87 @@
 #include "include/interpreter.hpp"
+#include "include/prepared.hpp"
+#include "include/vm/perf_map.hpp"
 
-int main() {
-    Interpreter program("text.txt");
-    program.parse_source();
-    program.parse_syntax();
-    program.print_ast();
-    return 0;
+// main [--ast | --bytecode] [--cache[=dir]] [--stats[=json]] [--profile[=file]] [--perf-map] [file]
+// --cache reuses the program compiled by an earlier run of the same source (default dir .proglang-cache)
+// --stats writes the time, allocations and output of every phase to stderr; it bypasses --cache
+// --profile samples the run every millisecond, writes the collapsed stacks for a flame graph
+//   to the file (default profile.folded) and the samples per source line to stderr
+// --perf-map names the run after the file in /tmp/perf-<pid>.map for perf (as PROGLANG_PERF_MAP=1 does)
+int main(int argc, char** argv) {
+    string file_name = "text.txt", mode, cache_dir, stats, profile;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--ast" || arg == "--bytecode")
+            mode = arg;
+        else if (arg == "--cache")
+            cache_dir = ".proglang-cache";
+        else if (arg.starts_with("--cache="))
+            cache_dir = arg.substr(8);
+        else if (arg == "--stats" || arg == "--stats=json")
+            stats = arg;
+        else if (arg == "--perf-map")
+            PerfMap::enable();
+        else if (arg == "--profile")
+            profile = "profile.folded";
+        else if (arg.starts_with("--profile="))
+            profile = arg.substr(10);
+        else
+            file_name = arg;
+    }
+
+    Interpreter program(file_name);
+    Profiler profiler;
+    auto write_profile = [&](const Program& compiled, const string_view& source) {
+        ofstream fout(profile);
+        if (!fout.is_open())
+            throw runtime_error("Cannot write profile " + profile);
+        SourceMap lines(source);
+        profiler.write_collapsed(fout, compiled, &lines);
+        profiler.write_lines(cerr, compiled, lines);
+    };
+    auto report = [&] {
+        if (stats == "--stats=json")
+            program.stats().write_json(cerr);
+        else if (!stats.empty())
+            program.stats().write(cerr);
+    };
+
+    try {
+        if (!cache_dir.empty() && stats.empty() && mode != "--ast") {
+            auto prepared = PreparedProgram::load(file_name, ProgramCache(cache_dir));
+            if (mode == "--bytecode") {
+                prepared.print_bytecode();
+                return 0;
+            }
+            if (profile.empty())
+                return prepared.run();
+            int result = prepared.run(profiler);
+            write_profile(prepared.program(), prepared.source());
+            return result;
+        }
+
+        int result = 0;
+        program.parse_source();
+        program.parse_syntax();
+        if (mode == "--ast") {
+            program.print_ast();
+        } else {
+            program.compile();
+            if (mode == "--bytecode")
+                program.print_bytecode();
+            else if (profile.empty())
+                result = program.run();
+            else {
+                result = program.run(profiler);
+                write_profile(program.bytecode(), program.source());
+            }
+        }
+        report();
+        return result;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        report();
+        return 1;
+    }
 }